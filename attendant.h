@@ -314,8 +314,477 @@ extern "C" {
 struct attendant__errors {
     int attendant;
     int system;
+    /* Milliseconds remaining before the next start of the plugin server
+     * process, when the attendant is waiting out a backoff or an open circuit,
+     * otherwise zero. */
+    int wait;
+    /* True if the crash loop circuit is open, which is why `ready` and `retry`
+     * returned false when there has been no final shutdown. */
+    int circuit;
 };
 
+/* Returned by `ready_until`, `retry_until` and `request_retry` when the crash
+ * loop circuit is open. Only returned if a crash limit is set in the backoff
+ * policy. `ready` and `retry` return false instead. */
+#define ATTENDANT_CIRCUIT_OPEN -1
+
+/* Returned by `ready_until`, `retry_until` and `request_retry` when the
+ * plugin server process is not running yet. `ready` and `retry` never return
+ * it. */
+#define ATTENDANT_NOT_YET -2
+
+/* States returned by `poll_state`. The plugin server process is starting or
+ * restarting, is running, will not be restarted until the crash loop circuit
+ * closes, has been told to shutdown but is still running, has shutdown for
+ * good, or is not running and will be launched by the next `ready` or `retry`.
+ */
+#define ATTENDANT_STATE_STARTING      1
+#define ATTENDANT_STATE_RUNNING       2
+#define ATTENDANT_STATE_CIRCUIT_OPEN  3
+#define ATTENDANT_STATE_SHUTDOWN      4
+#define ATTENDANT_STATE_DONE          5
+#define ATTENDANT_STATE_DORMANT       6
+
+/* A plugin server process that crashes at startup will be restarted by the
+ * starter in a tight loop, and every restart forks the host application. If you
+ * set a window, the attendant counts the crashes in a sliding window and waits
+ * before each restart, doubling the wait with each crash in the window, with a
+ * bit of jitter. If you set a limit, when the crashes in the window reach the
+ * limit, the circuit opens. The attendant waits out the cool down, while `ready`
+ * and `retry` return false immediately, instead of blocking, with the
+ * `circuit` member of `errors` set, so that you can tell it from a final
+ * shutdown. After the cool down, the attendant tries again.
+ *
+ * The waits are applied by `start` as if given as the `wait` argument, and can
+ * be cancelled by `shutdown` in the same way. Zero the structure to leave the
+ * restart policy entirely to the starter. */
+struct attendant__backoff {
+  /* Span of the sliding window in milliseconds, or zero to disable. */
+  int window;
+  /* Crashes within the window that open the circuit, or zero for never. */
+  int limit;
+  /* Wait in milliseconds before the second restart in the window. */
+  int initial;
+  /* Most we will ever wait in milliseconds between restarts, or zero for no
+   * maximum. */
+  int maximum;
+  /* Milliseconds that the circuit stays open. */
+  int cooldown;
+};
+
+/* A plugin server process that leaks will grow until the kernel kills it, and
+ * under a shared cgroup, it may take the host application with it. If you set
+ * an interval, the reaper thread samples the plugin server process from `/proc`
+ * at that interval, on Linux, and checks the policies below with each sample.
+ * When one is met, it waits for a quiet period, with no call to `ready` or
+ * `retry`, then recycles the plugin server process, as if for a `retry`, with
+ * a `SIGTERM`, then a `SIGKILL` half a second later. The starter is called as
+ * for any restart. Zero the structure to sample nothing and recycle never. */
+struct attendant__recycle {
+  /* Milliseconds between samples, or zero for none. */
+  int interval;
+  /* Recycle when the resident set is larger than this many bytes, or zero for
+   * never. */
+  long long rss;
+  /* Recycle when the plugin server process has been up for this many
+   * milliseconds, or zero for never. */
+  long long lifetime;
+  /* Recycle when the plugin server process uses at least this percent of a CPU
+   * in every sample for `pinned` milliseconds, or zero for never. */
+  int cpu;
+  int pinned;
+  /* Milliseconds without a call to `ready` or `retry` to wait for before we
+   * recycle, or zero to recycle at once. */
+  int quiet;
+};
+
+/* The last sample of the running plugin server process, as returned by
+ * `sample`. All zero if there is none. Sizes are in bytes, times in
+ * milliseconds. The I/O counts are zero if `/proc` will not tell. */
+struct attendant__sample {
+  /* When the sample was taken, by `clock`. */
+  long long taken;
+  int pid;
+  /* Milliseconds since the plugin server process was launched. */
+  long long uptime;
+  long long rss;
+  /* The largest the resident set has been. */
+  long long peak;
+  long long swap;
+  /* CPU time in user and system mode. */
+  long long cpu_time;
+  /* Percent of one CPU used since the last sample. */
+  int cpu;
+  int threads;
+  long long read_bytes;
+  long long write_bytes;
+};
+
+/* The resource usage of the last plugin server process to exit, from `wait4`,
+ * as returned by `usage`. All zero if there is none, or if `SIGCHLD` is
+ * ignored and we cannot wait. */
+struct attendant__usage {
+  int pid;
+  /* The status, as returned by `wait`. */
+  int status;
+  /* CPU time in user and system mode in milliseconds. */
+  long long user;
+  long long system;
+  /* The largest resident set in bytes. */
+  long long maxrss;
+  long long minflt;
+  long long majflt;
+  long long nvcsw;
+  long long nivcsw;
+};
+
+/* A plugin server process that will not exit within the grace period after a
+ * `SIGTERM` is hung, and the `SIGKILL` that follows destroys any evidence of
+ * why. If you give the plugin attendant a `snapshot` buffer size, then on
+ * Linux, the reaper thread first writes down what each thread of the plugin
+ * server process is doing, from `/proc/<pid>/task`. `snapshot` returns the
+ * last one taken, from the starter, say, when it is called for the restart.
+ *
+ * The snapshot is text, a line saying which process and when, then for each
+ * thread, a line with its id, name and state, followed by the kernel function
+ * it sleeps in, its system call number and arguments, and its kernel stack,
+ * if we are privileged enough to read it, each indented. Whatever does not
+ * fit in the buffer is left out.
+ *
+ *     pid 1234 at 56789
+ *     thread 1234 (server) S
+ *       wchan do_sigtimedwait
+ *       syscall 128 0x7ffd1c2c1e10 0x0 0x0 0x8 0x0 0x0 0x7ffd1c2c1df8 ...
+ *       [<0>] do_sigtimedwait+0x1b0/0x2a0
+ */
+
+/* The reaper thread drains standard out of the plugin server process so that
+ * it never blocks writing to it, and throws what it reads away, even if the
+ * plugin stub is reading it too. Set `stdio` to say who owns it. Standard error
+ * is left to the host application.
+ *
+ * Give the plugin attendant a `tail` and standard error comes to us instead,
+ * and we keep that many of the last bytes written to it by each plugin server
+ * process. When a plugin server process exits, the starter can ask for them
+ * with `tail`, for the exit status with `usage`, and is given the uptime,
+ * which is all you need to say why it crashed. The tail is emptied when the
+ * next plugin server process is launched. */
+
+/* We drain standard out. */
+#define ATTENDANT_STDIO_DRAIN   0
+/* Standard out belongs to the plugin stub and we never read it. */
+#define ATTENDANT_STDIO_STUB    1
+/* Standard out is ours, and goes to the log with standard error. */
+#define ATTENDANT_STDIO_LOG     2
+
+/* A plugin server process that is chatty in production can have its output
+ * written to a log file by the reaper thread. Give the plugin attendant a log
+ * `path` and standard error comes to us, as it does for a `tail`, and goes to
+ * the log, with standard out if `stdio` is `ATTENDANT_STDIO_LOG`. On Linux, we
+ * `splice` the pipes into the file, so the bytes never pass through the host
+ * application, unless we keep a `tail`, in which case we read standard error
+ * and write it. Every plugin attendant needs a log of its own.
+ *
+ * When the log reaches `size`, we rename it `path.1`, renaming `path.1` to
+ * `path.2`, and so on, keeping `keep` of them, and start a new one. With a
+ * `rate`, we log no more than that many bytes in a second, and drop the rest,
+ * noting in the log how many were dropped. */
+
+/* &#9824; */
+struct attendant__log {
+  /* The path of the log file, or an empty string for no log. */
+  char path[FILENAME_MAX];
+  /* Rotate the log when it reaches this many bytes, or zero for never. */
+  long long size;
+  /* The number of rotated logs to keep. */
+  int keep;
+  /* The most bytes to log in a second, or zero for no limit. */
+  long long rate;
+};
+
+/* ## Shared Mode
+ *
+ * A host application that runs as a flock of processes, like a browser, will
+ * load the plugin in every one of them, and every one will launch its own
+ * plugin server process. If the plugin server process is large, you can opt
+ * into sharing one among them by giving it a `rendezvous` name.
+ *
+ * A shared plugin server process listens on a UNIX domain socket named by
+ * `rendezvous` in `$XDG_RUNTIME_DIR`, which it creates itself, since it has to
+ * outlive the host process that launched it. At each start, the plugin
+ * attendant first tries to connect to that socket. If it connects, it is
+ * attached. It launches nothing, calls the connector with the socket as both
+ * `in` and `out`, and watches the socket, instead of the canary, for hang up.
+ * If it cannot connect, it launches the plugin server process as usual, and
+ * your starter should tell the plugin server process the `rendezvous` name.
+ *
+ * The plugin server process counts its references. Standard input is the
+ * reference of the plugin attendant that launched it, each connection is the
+ * reference of an attached plugin attendant. It exits when the last goes away.
+ * A host application that restarts reattaches to the plugin server process that
+ * is still running.
+ *
+ * An attached plugin attendant will not signal a plugin server process that
+ * other host processes share. `retry` and `scram` close the connection, and
+ * reconnect or not. `shutdown` then `done` wait for the plugin server process
+ * to hang up, so tell it that you are leaving, not that it should exit.
+ *
+ * If two host processes launch at once, both plugin server processes try to
+ * create the socket. The one that loses ought to exit, and its plugin attendant
+ * will then attach to the one that won.
+ *
+ * If `$XDG_RUNTIME_DIR` is not set, there is nowhere private to meet, and the
+ * plugin attendant launches a plugin server process of its own.
+ */
+
+/* ## Socket Activation
+ *
+ * A plugin server process that creates its own socket cannot accept
+ * connections while it is restarting. Give the plugin attendant a `listener`
+ * path and it will create the socket at initialization and listen on it for as
+ * long as it lives. Connections that arrive while the plugin server process is
+ * down wait in the backlog of the socket until the next one accepts them.
+ *
+ * The socket is passed to the plugin server process the way systemd passes
+ * sockets, at file descriptor 3, with `LISTEN_FDS` set to `1`, `LISTEN_PID`
+ * set to its process id and `LISTEN_FDNAMES` set to `listener`, so the canary
+ * must be some other file descriptor. `LISTEN_FDS` counts any other file
+ * descriptors passed after it, described below. The plugin server process must
+ * neither unlink the socket nor call `shutdown` on it.
+ *
+ * With `activate`, a dormant plugin attendant, one that is `lazy` or stopped
+ * for idleness, also wakes on the first connection, calling the starter as
+ * `ready` would. Connections do not count as activity for the `idle` policy.
+ */
+
+/* ## Inheritance
+ *
+ * A plugin server process that is replaced takes everything it opened with it,
+ * and the next one must open it all again. Give the plugin attendant an
+ * `inherit` count and the plugin server process can leave file descriptors to
+ * its successors, as a service can with the file descriptor store of systemd.
+ *
+ * The plugin server process finds a datagram socket at the file descriptor
+ * named by `ATTENDANT_REGISTRY` in its environment. To register a file
+ * descriptor, send the name as the message with the file descriptor attached
+ * as `SCM_RIGHTS`. A name is up to 31 letters, digits, dots, dashes and
+ * underscores. Sending a name again replaces the file descriptor, and sending
+ * a name with nothing attached forgets it. We keep a duplicate, so the plugin
+ * server process can go on using its own. We keep no more than `inherit` of
+ * them, and ignore any after that. The relay program passes no more than 63
+ * file descriptors in all, and we keep one for a blob, so `inherit` can be no
+ * more than 62, less one for a listener and one for the warm state.
+ *
+ * The next plugin server process receives them the way systemd passes them,
+ * starting at file descriptor 3, after the listener, the warm state and the
+ * blob, with `LISTEN_FDS`, `LISTEN_PID` and `LISTEN_FDNAMES` set, so the canary
+ * must be above them all, and above the registry socket, which comes last.
+ * They are duplicates, so a file offset or a socket is shared with the plugin
+ * server process that registered it, if it is still alive.
+ */
+
+/* ## Warm State
+ *
+ * A plugin server process that builds a large index in memory loses it to
+ * every restart, and the next one must build it again. Give the plugin
+ * attendant a `warm` size in bytes and it will create a region of shared
+ * memory at initialization, a `memfd` on Linux, an unlinked temporary file
+ * elsewhere. The region belongs to the plugin attendant, so it outlives every
+ * plugin server process, and it is released when the plugin attendant is
+ * destroyed.
+ *
+ * Every plugin server process receives the region at the same file
+ * descriptor, 3, or 4 if there is a listener, named `warm` in
+ * `LISTEN_FDNAMES`, and maps it with `MAP_SHARED`. The region begins with an
+ * `attendant__warm` header. The state follows it, at `ATTENDANT_WARM_HEADER`.
+ *
+ * We write the header once, with a `version` of zero, meaning that nothing has
+ * been built. The rest of the protocol belongs to the plugin server process.
+ * Before it changes the state, it increments `sequence`, making it odd. After
+ * it has changed the state and set `version` to the version of its layout, it
+ * increments `sequence` again, making it even. A plugin server process that
+ * starts and finds our `magic`, its own `version` and an even `sequence` can
+ * reattach to the state. Otherwise the last one died mid-change, or built
+ * something it does not understand, and it must build the state again.
+ *
+ * Use atomic operations or memory barriers on `sequence` if the plugin server
+ * process changes the state from more than one thread.
+ */
+
+/* &#9824; */
+struct attendant__warm {
+  /* `ATTENDANT_WARM_MAGIC`, written by the plugin attendant. */
+  unsigned int magic;
+  /* The version of the layout of the state, zero if nothing has been built. */
+  unsigned int version;
+  /* Odd while the state is being changed. */
+  unsigned long long sequence;
+  /* The size of the region, including this header. */
+  unsigned long long size;
+  /* The number of bytes of state in use, for the plugin server process to
+   * keep, if it likes. */
+  unsigned long long length;
+};
+
+/* The magic number of the header, and the offset of the state. */
+#define ATTENDANT_WARM_MAGIC        0x4d524157
+#define ATTENDANT_WARM_HEADER       64
+
+/* ## Sealed Blob
+ *
+ * A plugin stub that computes a large configuration should not have to feed it
+ * to every plugin server process through a pipe, nor should the plugin server
+ * process have to parse it every time. Start the plugin server process with
+ * `start_sealed` and a blob, and the plugin attendant will copy the blob once
+ * into a region that cannot be changed. On Linux it is a `memfd` with every
+ * seal. Elsewhere it is an unlinked temporary file, opened read only.
+ *
+ * The region is passed to this and every later plugin server process, so a
+ * starter that calls `start` on restart passes it again without a copy. Call
+ * `start_sealed` with another blob to replace it. Every plugin server process
+ * receives the region at the same file descriptor, after the listener and the
+ * warm state, named `blob` in `LISTEN_FDNAMES`, and the size of the blob is the
+ * size of the file. Map it `PROT_READ` and use it as it is. If there is
+ * something to validate, validate it before you call `start_sealed`.
+ */
+
+/* ## Companion Library
+ *
+ * The plugin attendant cannot see into the plugin server process, so `ready`
+ * returns as soon as the connector returns, which may be well before the
+ * plugin server process is serving, and the only way to ask it to shut down
+ * is through IPC of your own. Give the plugin attendant a true `companion` and
+ * link the plugin server program with the companion library, declared in
+ * `attendant_server.h`, and the plugin server process can tell us more.
+ *
+ * Each plugin server process gets a control socket, at the file descriptor
+ * named by `ATTENDANT_CONTROL` in its environment. It writes an `R` to say
+ * that it is ready, and `ready` waits for it. We write an `S` to say that
+ * `shutdown` has been called, so `shutdown` and `done` need no IPC of yours.
+ * The plugin server process should exit when it reads the `S`, or when the
+ * control socket hangs up, because then the plugin attendant is gone.
+ *
+ * It also gets a page of shared memory, at the file descriptor named by
+ * `ATTENDANT_HEARTBEAT`. The page begins with an `attendant__heartbeat`, and
+ * the plugin server process increments `beats` to say that it is alive. We
+ * set it to zero at each launch.
+ *
+ * With a `watchdog`, the reaper thread looks at the heartbeat, and if it has
+ * not moved for that many milliseconds since the plugin server process said
+ * that it was ready, the plugin server process is hung, and we restart it as
+ * if a plugin stub had called `retry`, with a `SIGTERM`, then a `SIGKILL` half
+ * a second later. A hang is found within twice the `watchdog`, with no help
+ * from the plugin stub threads stalled on it. Beat from the thread that does
+ * the work, not from a thread of its own, or the heartbeat will go on when the
+ * work has stopped.
+ *
+ * The control socket and the page are passed after all the others, with the
+ * registry socket, so the canary must be above them too.
+ */
+
+/* &#9824; */
+struct attendant__heartbeat {
+  /* Incremented by the plugin server process with each beat. */
+  unsigned long long beats;
+};
+
+/* ## Pressure
+ *
+ * When the machine is short of memory, a plugin server process with caches
+ * ought to drop them before the kernel starts to reclaim pages from the host
+ * application. Give the plugin attendant a `pressure` policy and, on Linux, it
+ * registers pressure stall triggers on `/proc/pressure/memory` and
+ * `/proc/pressure/cpu`, which the reaper thread polls. When a trigger fires,
+ * we write a word on the control socket of a plugin server process that uses
+ * the companion library, an `m` when some tasks stall on memory, an `M` when
+ * all of them do, and a `c` when some tasks wait for a CPU. The companion
+ * library gathers them for `attendant_server.pressure`.
+ *
+ * A trigger fires when tasks have stalled for the given number of milliseconds
+ * within the window, and fires no more than once a window. The kernel wants a
+ * window of half a second to ten seconds, and a multiple of two seconds if the
+ * host application is not privileged. If a trigger cannot be registered,
+ * `initialize` fails.
+ *
+ * Whether or not there are triggers, `pressure` reports the levels of pressure
+ * and how many times each trigger has fired.
+ */
+
+/* &#9824; */
+struct attendant__pressure {
+  /* The window in milliseconds, or zero for no triggers. */
+  int window;
+  /* Milliseconds in the window that some tasks stall on memory, that all tasks
+   * stall on memory, and that some tasks wait for a CPU, for each trigger to
+   * fire, or zero for no trigger. */
+  int some;
+  int full;
+  int cpu;
+};
+
+/* The triggers, as gathered by `attendant_server.pressure` and as reported
+ * in `last` below. */
+#define ATTENDANT_PRESSURE_SOME 0x1
+#define ATTENDANT_PRESSURE_FULL 0x2
+#define ATTENDANT_PRESSURE_CPU  0x4
+
+/* The pressure on the machine, as returned by `pressure`. The levels are the
+ * percent of the last ten seconds spent stalled, as `/proc/pressure` reports
+ * them, or zero if it does not. */
+struct attendant__stress {
+  double some;
+  double full;
+  double cpu;
+  /* The number of times each trigger has fired. */
+  long long some_fired;
+  long long full_fired;
+  long long cpu_fired;
+  /* When, by `clock`, a trigger last fired, and which, or zero if none has. */
+  long long fired;
+  int last;
+};
+
+/* ## Stable Endpoint
+ *
+ * Every restart runs the connector again, and the plugin stub must build its
+ * IPC anew, while the calls that were in flight are lost. If you can frame
+ * your calls, give the plugin attendant a `journal` and it will keep the
+ * channel for you. `endpoint` returns one end of a socket pair that stays the
+ * same for the life of the plugin attendant. The reaper thread carries frames
+ * from it to the standard input of each plugin server process in turn, and
+ * frames from standard output back, so do not use the standard I/O pipes
+ * yourself once the connector returns.
+ *
+ * Each frame is an `attendant__frame` header followed by `length` bytes. A
+ * request is remembered until a reply with the same `id` comes back, and the
+ * `journal` is the number of requests we will remember. When it is full, we
+ * stop reading the endpoint until a reply makes room. When the plugin server
+ * process exits, requests that it was sent and did not answer are replayed to
+ * the next one if they are marked `ATTENDANT_FRAME_IDEMPOTENT`. The others are
+ * answered by us, with an empty reply marked `ATTENDANT_FRAME_LOST`, since we
+ * cannot know whether they took effect. After a shutdown, every request
+ * outstanding is answered as lost.
+ *
+ * Your ids ought to be unique among requests outstanding. A reply whose `id`
+ * matches no request is passed along all the same, so the plugin server process
+ * can speak out of turn. Frames are in the byte order of the host.
+ */
+
+/* &#9824; */
+struct attendant__frame {
+  /* Number of bytes that follow the header. */
+  unsigned int length;
+  /* Matches a reply to its request. */
+  unsigned int id;
+  /* Flags below. */
+  unsigned int flags;
+};
+
+/* The request can safely be sent twice. The request was lost to a plugin
+ * server process exit. */
+#define ATTENDANT_FRAME_IDEMPOTENT  1
+#define ATTENDANT_FRAME_LOST        2
+
 /* On UNIX a pipe is a file descriptor. On Windows, a pipe a `HANDLE`. */
 #ifdef _WIN32
 typedef HANDLE attendant__pipe_t;
@@ -323,6 +792,9 @@ typedef HANDLE attendant__pipe_t;
 typedef int attendant__pipe_t;
 #endif
 
+/* A handle to a plugin attendant created by `attendant_new`. */
+struct attendant__process;
+
 struct attendant__initializer {
   /* A function to invoke to start the attendant in the event of an unexpected
    * shutdown. The `uptime` is the number of seconds the out-of-process plugin
@@ -349,11 +821,74 @@ struct attendant__initializer {
   attendant__pipe_t canary;
   /* */
 #endif
+  /* Crash loop detection and backoff. */
+  struct attendant__backoff backoff;
+  /* For a plugin attendant created by `attendant_new`, a starter that is given
+   * the handle, so that it can call `attendant_start`, and the context below.
+   * Used instead of `starter` when set. */
+  void (*starter_r)(struct attendant__process *process, void *context,
+    int restart, int uptime);
+  /* A connector that is given the context below. Used instead of `connector`
+   * when set. */
+  void (*connector_r)(void *context, attendant__pipe_t in,
+    attendant__pipe_t out);
+  /* Passed to `starter_r` and `connector_r`. */
+  void *context;
+  /* If true, the plugin server process is not launched until the first call to
+   * `ready` or `retry`, which will call the starter for you. You do not call
+   * the starter at library load, so merely loading the plugin costs no fork. */
+  int lazy;
+  /* Milliseconds without a call to `ready` or `retry` after which we stop the
+   * plugin server process, with a `SIGTERM`, then a `SIGKILL` half a second
+   * later. It is launched again by the next call to `ready` or `retry`. Make
+   * it far longer than any call you make to the plugin server process, since
+   * we cannot see calls in flight. Zero for never. */
+  int idle;
+  /* The name of a shared plugin server process, or an empty string for a
+   * plugin server process of our own. See **Shared Mode** above. */
+  char rendezvous[FILENAME_MAX];
+  /* The path of a UNIX domain socket that the plugin attendant will listen on
+   * and pass to the plugin server process, or an empty string for none. See
+   * **Socket Activation** above. */
+  char listener[FILENAME_MAX];
+  /* If true, a dormant plugin server process is also launched by the first
+   * connection to the listener. */
+  int activate;
+  /* The number of requests we remember for replay, or zero for no stable
+   * endpoint. See **Stable Endpoint** above. */
+  int journal;
+  /* The number of file descriptors the plugin server process may leave to its
+   * successors, or zero for none. See **Inheritance** above. */
+  int inherit;
+  /* The size in bytes of the warm state region, including its header, or zero
+   * for none. See **Warm State** above. */
+  size_t warm;
+  /* If true, the plugin server process uses the companion library, and
+   * `ready` waits for it to say so. See **Companion Library** above. */
+  int companion;
+  /* Milliseconds without a heartbeat after which we restart a plugin server
+   * process that uses the companion library, or zero for never. */
+  int watchdog;
+  /* Resource sampling and recycling. */
+  struct attendant__recycle recycle;
+  /* Memory and CPU pressure triggers. See **Pressure** above. */
+  struct attendant__pressure pressure;
+  /* The size in bytes of the hang snapshot buffer, or zero to take no
+   * snapshots. */
+  int snapshot;
+  /* Who owns standard out, `ATTENDANT_STDIO_DRAIN`, `ATTENDANT_STDIO_STUB` or
+   * `ATTENDANT_STDIO_LOG`, which sends it to the log given in `logging`. With
+   * a `journal`, standard out is always ours, and never logged. */
+  int stdio;
+  /* The number of bytes of standard error to keep, or zero for none. */
+  int tail;
+  /* Where standard error and standard out go. */
+  struct attendant__log logging;
 /* &mdash; */
 };
 
-/* There is one instance of the plugin attendant that monitors only one instance
- * of the plugin server process. The plugin attendant functions are contained
+/* There is one default instance of the plugin attendant that monitors only one
+ * instance of the plugin server process. The plugin attendant functions are contained
  * within a structure which emulates a namespace. The plugin attendant functions
  * are called by referencing them within the structure. An invocation of the
  * plugin attendant function would appear as `attendant.initialize()` in client
@@ -430,7 +965,8 @@ struct attendant {
    * the plugin server process over an IPC channel that the plugin server
    * process has yet to initialize. To avoid this race condition, you could use
    * the stdout pipe to listen for an okay of some kind form the plugin server
-   * process.
+   * process, or use the companion library, and `ready` will wait for the plugin
+   * server process to say that it is ready.
    *
    * The standard I/O pipes will be established when the `ready` function
    * returns true.
@@ -438,6 +974,15 @@ struct attendant {
    * If the `ready` function returns false the plugin attendant has entered the
    * final shutdown state and the plugin process will never run. This would be
    * due to a catastrophic error, such a missing plugin server program file.
+   *
+   * If the crash loop circuit is open, `ready` returns false immediately, but
+   * the `circuit` member of `errors` is true, and the `wait` member tells you
+   * how long it will stay open. This is not the final shutdown state.
+   *
+   * If the plugin attendant is lazy, or the plugin server process was stopped
+   * for idleness, `ready` calls the starter, with a `restart` of zero, from the
+   * calling thread, and then waits as usual. The calls that take a deadline
+   * leave the starter to a thread of the plugin attendant.
    */
 
   /* &#9824; */
@@ -464,7 +1009,10 @@ struct attendant {
    * shutdown state. The plugin server process will not be restarted. The reason
    * may be obtained using the `errors` function. If the attendant error code is
    * `0`, that indicates that there is no error, and the plugin attendant
-   * entered the final shutdown state due to an orderly shutdown. */
+   * entered the final shutdown state due to an orderly shutdown.
+   *
+   * If the crash loop circuit is open, `retry` returns false immediately, as
+   * does `ready`, with the `circuit` member of `errors` set. */
 
   /* &#9824; */
   int (*retry)(int millis);
@@ -572,12 +1120,258 @@ struct attendant {
   /* &#9824; */
   int (*destroy)();
 
+  /* `clock` &mdash; Returns the time of the monotonic clock in milliseconds. The
+   * deadlines given to `ready_until` and `retry_until` are times of this clock,
+   * so a deadline a quarter second from now is `attendant.clock() + 250`. The
+   * clock is not affected by changes to the system clock.
+   */
+
+  /* &#9824; */
+  long long (*clock)();
+
+  /* `ready_until` &mdash; Like `ready`, but only blocks until the deadline. If
+   * the deadline passes before the plugin server process is running, returns
+   * `ATTENDANT_NOT_YET`. A deadline in the past will check without blocking.
+   * If the crash loop circuit is open, returns `ATTENDANT_CIRCUIT_OPEN`.
+   *
+   * Use this in threads that cannot block for the seconds a restart might take,
+   * like user interface or audio threads, so they can degrade gracefully and
+   * try again later. If the plugin attendant is dormant, the starter is called
+   * from a thread of the plugin attendant, not the calling thread.
+   */
+
+  /* &#9824; */
+  int (*ready_until)(long long deadline);
+
+  /* `retry_until` &mdash; Like `retry`, but only blocks until the deadline,
+   * returning `ATTENDANT_NOT_YET` if the deadline passes before the replacement
+   * plugin server process is running. The restart continues regardless. A
+   * subsequent call to `retry` or `retry_until` from the same thread will wait
+   * on the restart already underway, it will not request another.
+   */
+
+  /* &#9824; */
+  int (*retry_until)(int millis, long long deadline);
+
+  /* `fd` &mdash; Returns a pipe that becomes readable whenever the state of
+   * the plugin attendant changes. Add it to the event loop of a single
+   * threaded host application and call `poll_state` when it is readable. Do
+   * not read from it or close it yourself.
+   */
+
+  /* &#9824; */
+  attendant__pipe_t (*fd)();
+
+  /* `poll_state` &mdash; Drains the pipe returned by `fd` and returns the
+   * current state, one of the `ATTENDANT_STATE_` constants. Never blocks. Once
+   * the state is `ATTENDANT_STATE_DONE`, `done` will not block.
+   */
+
+  /* &#9824; */
+  int (*poll_state)();
+
+  /* `request_retry` &mdash; Like `retry`, but never blocks. Requests a restart,
+   * if one has not already been requested on behalf of this thread, and returns
+   * true if the replacement plugin server process is already running, or
+   * `ATTENDANT_NOT_YET` if you should wait for the `fd` to become readable.
+   */
+
+  /* &#9824; */
+  int (*request_retry)(int millis);
+
+  /* `request_shutdown` &mdash; Like `shutdown`, but never blocks. Wait for
+   * `poll_state` to report `ATTENDANT_STATE_SHUTDOWN` or
+   * `ATTENDANT_STATE_DONE` before you tell the plugin server process to exit.
+   */
+
+  /* &#9824; */
+  int (*request_shutdown)();
+
+  /* `endpoint` &mdash; Returns the plugin stub end of the stable endpoint, or
+   * `-1` if there is no journal. It is the same for the life of the plugin
+   * attendant. Do not close it yourself.
+   */
+
+  /* &#9824; */
+  attendant__pipe_t (*endpoint)();
+
+  /* `start_sealed` &mdash; Like `start`, but first seals a copy of the
+   * `length` bytes at `blob` and passes it to this and every later plugin
+   * server process. Pass `NULL` to keep the blob already sealed. See **Sealed
+   * Blob** above.
+   */
+
+  /* &#9824; */
+  int (*start_sealed)(const char* path, char const* argv[], int wait,
+    const void *blob, size_t length);
+
+  /* `sample` &mdash; Returns the last sample of the running plugin server
+   * process, taken at the `recycle` interval, all zero if there is none.
+   */
+
+  /* &#9824; */
+  struct attendant__sample (*sample)();
+
+  /* `usage` &mdash; Returns the resource usage of the last plugin server
+   * process to exit, all zero if none has.
+   */
+
+  /* &#9824; */
+  struct attendant__usage (*usage)();
+
+  /* `pressure` &mdash; Returns the levels of memory and CPU pressure on the
+   * machine and the number of times each `pressure` trigger has fired.
+   */
+
+  /* &#9824; */
+  struct attendant__stress (*pressure)();
+
+  /* `snapshot` &mdash; Copies the last hang snapshot into the buffer, null
+   * terminated and cut short to fit, and returns its length, or zero if none
+   * has been taken.
+   */
+
+  /* &#9824; */
+  int (*snapshot)(char *buffer, int size);
+
+  /* `tail` &mdash; Copies the last of what the plugin server process wrote to
+   * standard error into the buffer, oldest first, null terminated and cut
+   * short to fit, and returns its length. Called from the starter, it is the
+   * tail of the plugin server process that exited.
+   */
+
+  /* &#9824; */
+  int (*tail)(char *buffer, int size);
+
+  /* `acknowledge` &mdash; Takes note of the running plugin server process as
+   * the one known to this thread, as `retry` does when it returns true, so
+   * that the next `retry` from this thread asks for its restart. Call it when
+   * you learn that the plugin server process is running some other way, from
+   * `ready_until` on another thread, say. Returns the instance number, or zero
+   * if no plugin server process is running.
+   */
+
+  /* &#9824; */
+  int (*acknowledge)();
+
   /* */
 };
 
 /* The one and only plugin attendant. */
 extern struct attendant attendant;
 
+/* ## Handles
+ *
+ * The one and only plugin attendant above is a default instance. A host that
+ * must supervise more than one plugin server process, one per tenant say, can
+ * create as many plugin attendants as it likes with `attendant_new`. Each has
+ * its own mutex, threads and pipes, and shares nothing with the others, nor
+ * with the default instance. Each has its own thread local storage key as well,
+ * so you can create no more than `PTHREAD_KEYS_MAX` of them.
+ *
+ * The functions below are the functions of `struct attendant`, taking the
+ * handle as their first argument. Use `starter_r` and `connector_r` in the
+ * initializer so that your callbacks know which plugin attendant called them.
+ *
+ * Before you go and create dozens of these, reread the limitations above. The
+ * host application is forked for every start of every plugin server process.
+ * A plugin server process that monitors a flock is still the better design.
+ */
+
+/* Returns a new plugin attendant, or `NULL` if it cannot be initialized, with
+ * `errno` set if the system is to blame. */
+struct attendant__process *attendant_new(
+  struct attendant__initializer *initializer);
+
+/* Frees the plugin attendant. Call after `attendant_done`. */
+int attendant_destroy(struct attendant__process *process);
+
+int attendant_start(struct attendant__process *process, const char* path,
+  char const* argv[], int wait);
+int attendant_ready(struct attendant__process *process);
+int attendant_retry(struct attendant__process *process, int millis);
+int attendant_shutdown(struct attendant__process *process);
+int attendant_done(struct attendant__process *process, int milliseconds);
+int attendant_scram(struct attendant__process *process);
+struct attendant__errors attendant_errors(struct attendant__process *process);
+int attendant_ready_until(struct attendant__process *process,
+  long long deadline);
+int attendant_retry_until(struct attendant__process *process, int millis,
+  long long deadline);
+attendant__pipe_t attendant_fd(struct attendant__process *process);
+int attendant_poll_state(struct attendant__process *process);
+int attendant_request_retry(struct attendant__process *process, int millis);
+int attendant_request_shutdown(struct attendant__process *process);
+attendant__pipe_t attendant_endpoint(struct attendant__process *process);
+struct attendant__sample attendant_sample(struct attendant__process *process);
+struct attendant__usage attendant_usage(struct attendant__process *process);
+struct attendant__stress attendant_pressure(
+  struct attendant__process *process);
+int attendant_snapshot(struct attendant__process *process, char *buffer,
+  int size);
+int attendant_tail(struct attendant__process *process, char *buffer,
+  int size);
+int attendant_acknowledge(struct attendant__process *process);
+int attendant_start_sealed(struct attendant__process *process,
+  const char* path, char const* argv[], int wait, const void *blob,
+  size_t length);
+
+/* ## Pools
+ *
+ * A plugin server process that is single threaded, or CPU bound, will use no
+ * more than the one core it is given. A pool runs several plugin server
+ * processes, each under a plugin attendant of its own, so that each is
+ * restarted independently, and a crash only takes one member out of service.
+ *
+ * Create the pool with a context for each member. The member's plugin
+ * attendant gets your initializer with its own context, so use `starter_r` and
+ * `connector_r`, start each member with `attendant_start`, and keep the IPC
+ * channel of each member in its context.
+ *
+ * To make a call, `attendant_pool_acquire` a slot, make the call over that
+ * slot's channel, and `attendant_pool_release` the slot. Members whose plugin
+ * server process is restarting are passed over, unless they all are. If the
+ * call fails, `attendant_retry` the member in that slot, as you would with a
+ * single plugin attendant.
+ *
+ * On Linux, members can be pinned, each to a core of its own, or each to the
+ * cores of a NUMA node, going round robin. Elsewhere, pinning is ignored.
+ */
+
+/* Do not pin, pin each member to a core, or to the cores of a NUMA node. */
+#define ATTENDANT_PIN_NONE  0
+#define ATTENDANT_PIN_CORE  1
+#define ATTENDANT_PIN_NODE  2
+
+/* Dispatch to the member with the fewest calls in flight, or to the better of
+ * two members chosen at random. */
+#define ATTENDANT_BALANCE_LEAST        0
+#define ATTENDANT_BALANCE_TWO_CHOICES  1
+
+/* A handle to a pool of plugin attendants. */
+struct attendant__pool;
+
+/* Returns a new pool of `size` plugin attendants, or `NULL` if any one of them
+ * cannot be created. */
+struct attendant__pool *attendant_pool_new(
+  struct attendant__initializer *initializer, void *contexts[], int size,
+  int pin);
+
+int attendant_pool_size(struct attendant__pool *pool);
+
+/* The plugin attendant in the given slot. */
+struct attendant__process *attendant_pool_process(struct attendant__pool *pool,
+  int slot);
+
+/* Returns the slot to dispatch a call to, counting the call as in flight. */
+int attendant_pool_acquire(struct attendant__pool *pool, int balance);
+
+/* Count the call to the given slot as no longer in flight. */
+void attendant_pool_release(struct attendant__pool *pool, int slot);
+
+/* Destroys every plugin attendant in the pool. Call after each is done. */
+int attendant_pool_destroy(struct attendant__pool *pool);
+
 /* Love, C. */
 #ifdef __cplusplus
 }
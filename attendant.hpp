@@ -0,0 +1,428 @@
+/* A C++20 wrapper around the plugin attendant.
+ *
+ * The plugin attendant is written in C and its functions block. A plugin stub
+ * written in C++ with coroutines would rather not park a thread in `ready` or
+ * `retry` for the seconds a restart might take, so we build on the notify pipe
+ * and the non-blocking functions to give you awaiters that suspend the
+ * coroutine instead, and resume it when the state of the attendant changes.
+ *
+ * &#9824; &nbsp; `session` &mdash; An RAII lifetime for the one and only plugin
+ * attendant. Initializes on construction. On destruction, shuts down, waits a
+ * grace period for the plugin server process to exit, scrams if it does not,
+ * and destroys.
+ *
+ * &#9824; &nbsp; `reactor` &mdash; Parks suspended coroutines and resumes them.
+ * Either add `fd` to your own event loop and call `dispatch` when it is
+ * readable, or call `run_once` in a loop of your own, which will also wait on
+ * the channels below.
+ *
+ * &#9824; &nbsp; `channel` &mdash; A move-only owner of a file descriptor, with
+ * awaitable non-blocking reads and writes, so that any number of calls can be
+ * in flight to the plugin server process without a thread apiece. Use it for
+ * the IPC your connector establishes. The plugin stub end of the standard I/O
+ * pipes belongs to the attendant, whose reaper thread drains standard out.
+ *
+ * Everything here is in the `attendant_cpp` namespace, because the name
+ * `attendant` is taken by the one and only plugin attendant.
+ */
+#ifndef ATTENDANT_HPP
+#define ATTENDANT_HPP
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "attendant.h"
+
+namespace attendant_cpp {
+
+/* Thrown when the plugin attendant fails to initialize or start, carrying the
+ * error codes from `errors`. */
+
+/* &#9824; */
+class error : public std::runtime_error {
+public:
+  error(const char *what, struct attendant__errors errors)
+    : std::runtime_error(what), errors(errors) {}
+  struct attendant__errors errors;
+};
+
+/* ### Session */
+
+/* &#9824; */
+class session {
+public:
+  explicit session(struct attendant__initializer &initializer,
+      std::chrono::milliseconds grace = std::chrono::seconds(5))
+    : grace_(grace) {
+    if (::attendant.initialize(&initializer) != 0) {
+      throw error("attendant initialize", ::attendant.errors());
+    }
+  }
+
+  session(const session&) = delete;
+  session& operator=(const session&) = delete;
+
+  /* You ought to have told the plugin server process to exit by now. If you
+   * did not, we give it the grace period to notice that it ought to, then we
+   * pull the rug out from under it. */
+  ~session() {
+    if (! shutdown_) {
+      ::attendant.shutdown();
+    }
+    if (! done_) {
+      if (! ::attendant.done(static_cast<int>(grace_.count()))) {
+        ::attendant.scram();
+        ::attendant.done(-1);
+      }
+    }
+    ::attendant.destroy();
+  }
+
+  void start(const char *path, char const *argv[],
+      std::chrono::milliseconds wait = std::chrono::milliseconds(0)) {
+    if (::attendant.start(path, argv, static_cast<int>(wait.count())) != 0) {
+      throw error("attendant start", ::attendant.errors());
+    }
+  }
+
+  void start(const char *path, char const *argv[], const void *blob,
+      size_t length,
+      std::chrono::milliseconds wait = std::chrono::milliseconds(0)) {
+    if (::attendant.start_sealed(path, argv, static_cast<int>(wait.count()),
+          blob, length) != 0) {
+      throw error("attendant start", ::attendant.errors());
+    }
+  }
+
+  bool shutdown() {
+    shutdown_ = true;
+    return ::attendant.shutdown();
+  }
+
+  bool request_shutdown() {
+    shutdown_ = true;
+    return ::attendant.request_shutdown();
+  }
+
+  bool scram() {
+    shutdown_ = true;
+    return ::attendant.scram();
+  }
+
+  /* The reaper thread can only be joined once, so we remember if we have. A
+   * negative timeout waits forever. */
+  bool done(std::chrono::milliseconds timeout) {
+    if (! done_) {
+      done_ = ::attendant.done(static_cast<int>(timeout.count()));
+    }
+    return done_;
+  }
+
+  struct attendant__errors errors() const {
+    return ::attendant.errors();
+  }
+
+private:
+  std::chrono::milliseconds grace_;
+  bool shutdown_ = false;
+  bool done_ = false;
+};
+
+/* ### Reactor */
+
+/* &#9824; */
+class reactor {
+public:
+  /* A suspended coroutine and the test that tells us it can resume. A waiter
+   * with a file descriptor is also waiting on I/O. */
+  struct waiter {
+    virtual ~waiter() = default;
+    virtual bool satisfied() = 0;
+    std::coroutine_handle<> handle;
+    int fd = -1;
+    short events = 0;
+  };
+
+  /* Draining the notify pipe at construction is fine, there is no one parked
+   * yet. */
+  reactor() : state_(::attendant.poll_state()) {}
+
+  reactor(const reactor&) = delete;
+  reactor& operator=(const reactor&) = delete;
+
+  /* The file descriptor to add to your own event loop. */
+  int fd() const {
+    return ::attendant.fd();
+  }
+
+  /* The state as of the last dispatch, one of the `ATTENDANT_STATE_`
+   * constants. */
+  int state() const {
+    return state_;
+  }
+
+  /* Call when `fd` is readable. */
+  void dispatch() {
+    state_ = ::attendant.poll_state();
+    resume();
+  }
+
+  /* Wait up to the timeout for a change of state or for a channel to become
+   * ready, then resume whoever can be resumed. Returns false if no one is
+   * parked. */
+  bool run_once(std::chrono::milliseconds timeout) {
+    std::vector<struct pollfd> fds;
+    struct pollfd notify = { ::attendant.fd(), POLLIN, 0 };
+    int err;
+
+    fds.push_back(notify);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (parked_.empty()) {
+        return false;
+      }
+      for (waiter *w : parked_) {
+        if (w->fd != -1) {
+          struct pollfd pollfd = { w->fd, w->events, 0 };
+          fds.push_back(pollfd);
+        }
+      }
+    }
+
+    do {
+      err = ::poll(fds.data(), fds.size(), static_cast<int>(timeout.count()));
+    } while (err == -1 && errno == EINTR);
+
+    if (fds[0].revents) {
+      state_ = ::attendant.poll_state();
+    }
+    resume();
+
+    return true;
+  }
+
+  /* Park the waiter, unless it can already resume, which closes the window
+   * between the check in `await_ready` and now. Returns false if the waiter
+   * should not suspend after all. */
+  bool park(waiter *w, std::coroutine_handle<> handle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (w->satisfied()) {
+      return false;
+    }
+    w->handle = handle;
+    parked_.push_back(w);
+    return true;
+  }
+
+private:
+  /* Gather the waiters that can resume under the lock, but resume them outside
+   * of it, because they may well park again. */
+  void resume() {
+    std::vector<std::coroutine_handle<> > ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto i = parked_.begin(); i != parked_.end();) {
+        if ((*i)->satisfied()) {
+          ready.push_back((*i)->handle);
+          i = parked_.erase(i);
+        } else {
+          ++i;
+        }
+      }
+    }
+    for (auto handle : ready) {
+      handle.resume();
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<waiter*> parked_;
+  int state_;
+};
+
+/* ### Awaiters */
+
+/* `co_await ready(reactor)` resumes with `1` when the plugin server process is
+ * running, `0` if it never will, or `ATTENDANT_CIRCUIT_OPEN`. */
+
+/* &#9824; */
+class ready : public reactor::waiter {
+public:
+  explicit ready(reactor &r) : reactor_(r) {}
+  bool await_ready() {
+    return satisfied();
+  }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    return reactor_.park(this, handle);
+  }
+  int await_resume() {
+    return status_;
+  }
+  bool satisfied() override {
+    status_ = ::attendant.ready_until(0);
+    return status_ != ATTENDANT_NOT_YET;
+  }
+protected:
+  reactor &reactor_;
+  int status_ = ATTENDANT_NOT_YET;
+};
+
+/* `co_await retry(reactor, millis)` asks for a restart, if one has not been
+ * asked for already, and resumes as `ready` does. The request is made when
+ * the awaiter is awaited. If the coroutine resumes on another thread, we only
+ * check readiness, so we never ask for a second restart. When it resumes
+ * running, the thread it resumes on acknowledges the new plugin server
+ * process, so that a plain `retry` from that thread restarts it in turn. */
+
+/* &#9824; */
+class retry : public ready {
+public:
+  retry(reactor &r, int millis) : ready(r), millis_(millis) {}
+  bool await_ready() {
+    status_ = ::attendant.request_retry(millis_);
+    return status_ != ATTENDANT_NOT_YET;
+  }
+  int await_resume() {
+    if (status_ == 1) {
+      ::attendant.acknowledge();
+    }
+    return status_;
+  }
+private:
+  int millis_;
+};
+
+/* `co_await done(reactor, session)` resumes when the plugin server process has
+ * exited after shutdown, and joins the reaper, which will not block. */
+
+/* &#9824; */
+class done : public reactor::waiter {
+public:
+  done(reactor &r, session &s) : reactor_(r), session_(s) {}
+  bool await_ready() {
+    return satisfied();
+  }
+  bool await_suspend(std::coroutine_handle<> handle) {
+    return reactor_.park(this, handle);
+  }
+  bool await_resume() {
+    return session_.done(std::chrono::milliseconds(-1));
+  }
+  bool satisfied() override {
+    return reactor_.state() == ATTENDANT_STATE_DONE;
+  }
+private:
+  reactor &reactor_;
+  session &session_;
+};
+
+/* ### Channel */
+
+/* &#9824; */
+class channel {
+public:
+  channel() = default;
+
+  /* Takes ownership of the file descriptor and makes it non-blocking. */
+  explicit channel(int fd) : fd_(fd) {
+    if (fd_ != -1) {
+      ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    }
+  }
+
+  channel(channel &&other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+  channel& operator=(channel &&other) noexcept {
+    if (this != &other) {
+      reset();
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+
+  channel(const channel&) = delete;
+  channel& operator=(const channel&) = delete;
+
+  ~channel() {
+    reset();
+  }
+
+  int get() const {
+    return fd_;
+  }
+
+  explicit operator bool() const {
+    return fd_ != -1;
+  }
+
+  int release() {
+    return std::exchange(fd_, -1);
+  }
+
+  void reset() {
+    if (fd_ != -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  /* An awaitable `read` or `write`. Resumes with the result of the system
+   * call, or `-1` with `errno` set, for any error other than `EAGAIN`. */
+  template <bool Write>
+  class io : public reactor::waiter {
+  public:
+    io(reactor &r, int fd, void *buffer, size_t size)
+      : reactor_(r), buffer_(buffer), size_(size) {
+      this->fd = fd;
+      this->events = Write ? POLLOUT : POLLIN;
+    }
+    bool await_ready() {
+      return satisfied();
+    }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return reactor_.park(this, handle);
+    }
+    ssize_t await_resume() {
+      errno = errno_;
+      return result_;
+    }
+    bool satisfied() override {
+      do {
+        result_ = Write ? ::write(fd, buffer_, size_) : ::read(fd, buffer_, size_);
+      } while (result_ == -1 && errno == EINTR);
+      errno_ = errno;
+      return result_ != -1 || (errno != EAGAIN && errno != EWOULDBLOCK);
+    }
+  private:
+    reactor &reactor_;
+    void *buffer_;
+    size_t size_;
+    ssize_t result_ = -1;
+    int errno_ = 0;
+  };
+
+  io<false> read(reactor &r, void *buffer, size_t size) {
+    return io<false>(r, fd_, buffer, size);
+  }
+
+  io<true> write(reactor &r, const void *buffer, size_t size) {
+    return io<true>(r, fd_, const_cast<void*>(buffer), size);
+  }
+
+private:
+  int fd_ = -1;
+};
+
+} /* namespace attendant_cpp */
+
+#endif /* ATTENDANT_HPP */
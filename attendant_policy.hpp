@@ -0,0 +1,660 @@
+/* A compile time, policy based plugin attendant for C++17.
+ *
+ * The C plugin attendant decides how it spawns, how it detects exit, and how it
+ * waits, at compile time with `#ifdef __MACH__` and at run time with checks
+ * like `process.waitable`, because it has to cope with whatever host
+ * application loads it. If you know your deployment, you can choose instead,
+ * and get a build with no indirect calls and no branches you will never take.
+ *
+ *     basic_attendant<Spawn, ExitDetect, Wait, Restart>
+ *
+ * &#9824; &nbsp; `Spawn` &mdash; `fork_exec` forks and execs in the child,
+ * calling only async-safe functions. `posix_spawn_exec` uses `posix_spawn`,
+ * which can use `vfork` or `clone` under the covers, and is much cheaper when
+ * the host application is large.
+ *
+ * &#9824; &nbsp; `ExitDetect` &mdash; `canary_exit` polls for the hang up of
+ * the canary pipe, as the C attendant does. `pidfd_exit` polls a Linux process
+ * file descriptor. `waitpid_exit` uses `waitpid` alone, which requires that the
+ * host application leaves `SIGCHLD` alone. All of them reap the child.
+ *
+ * &#9824; &nbsp; `Wait` &mdash; `condvar_wait` parks waiters on a condition
+ * variable. `futex_wait` parks them on a Linux futex, without a mutex.
+ *
+ * &#9824; &nbsp; `Restart` &mdash; `always_restart`, `never_restart` or
+ * `backoff_restart<Initial, Maximum>`.
+ *
+ * Both spawn policies launch the same relay program, with the same arguments,
+ * as the C attendant, so the plugin server process gets the same clean slate.
+ *
+ * The C `struct attendant` cannot itself become an instantiation of a
+ * template, it has to remain callable from C and to work in any host. The
+ * closest instantiation is `posix_attendant` below.
+ *
+ * Unlike the C attendant, we do not drain standard out and standard error of
+ * the plugin server process. Those belong to your connector.
+ */
+#ifndef ATTENDANT_POLICY_HPP
+#define ATTENDANT_POLICY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+extern char **environ;
+
+namespace attendant_cpp {
+
+/* Milliseconds of the monotonic clock. Deadlines are times of this clock, and
+ * a negative deadline is no deadline at all. */
+inline long long monotonic() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Returned by `ready` and `retry` when the deadline passes. The same value as
+ * `ATTENDANT_NOT_YET` in `attendant.h`. */
+constexpr int not_yet = -2;
+
+/* The plugin stub end of a launched plugin server process. */
+struct child {
+  pid_t pid = 0;
+  /* Read end of the canary pipe. */
+  int canary = -1;
+};
+
+/* The plugin server end of the pipes, which the spawn policies arrange at the
+ * standard I/O and canary file descriptor numbers of the relay. */
+struct plumbing {
+  int in, out, err, canary, canary_fd;
+};
+
+/* ### Spawn */
+
+/* &#9824; */
+struct fork_exec {
+  static pid_t spawn(const char *relay, char *const argv[], const plumbing &p) {
+    sigset_t all, mask;
+    pid_t pid;
+
+    /* Block signals across the fork, so that no host application handler runs
+     * in the child before we exec. */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &mask);
+    pid = fork();
+    if (pid == 0) {
+      dup2(p.in, STDIN_FILENO);
+      dup2(p.out, STDOUT_FILENO);
+      dup2(p.err, STDERR_FILENO);
+      dup2(p.canary, p.canary_fd);
+      sigemptyset(&all);
+      sigprocmask(SIG_SETMASK, &all, NULL);
+      execv(relay, argv);
+      _exit(127);
+    }
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+
+    return pid;
+  }
+};
+
+/* &#9824; */
+struct posix_spawn_exec {
+  static pid_t spawn(const char *relay, char *const argv[], const plumbing &p) {
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t none;
+    pid_t pid;
+    int err;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, p.in, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, p.out, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, p.err, STDERR_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, p.canary, p.canary_fd);
+
+    posix_spawnattr_init(&attr);
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    err = posix_spawn(&pid, relay, &actions, &attr, argv, environ);
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    return err == 0 ? pid : -1;
+  }
+};
+
+/* ### Exit Detection
+ *
+ * Each policy waits until the child exits, up to the timeout, or until the wake
+ * pipe is readable, and returns true if the child exited, having reaped it.
+ * `ECHILD` means the host application reaped it first, which is exit enough.
+ */
+
+namespace detail {
+  inline bool poll_exit(int fd, short events, int timeout, int wake) {
+    struct pollfd fds[2] = { { fd, events, 0 }, { wake, POLLIN, 0 } };
+    int err;
+    do {
+      err = poll(fds, 2, timeout);
+    } while (err == -1 && errno == EINTR);
+    return err > 0 && fds[0].revents != 0;
+  }
+
+  inline void reap(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR);
+  }
+}
+
+/* &#9824; */
+struct canary_exit {
+  struct handle {
+    explicit handle(const child &c) : c(c) {}
+    bool wait(int timeout, int wake) {
+      if (detail::poll_exit(c.canary, POLLHUP, timeout, wake)) {
+        detail::reap(c.pid);
+        return true;
+      }
+      return false;
+    }
+    child c;
+  };
+};
+
+#if defined(__linux__) && defined(SYS_pidfd_open)
+/* &#9824; */
+struct pidfd_exit {
+  struct handle {
+    explicit handle(const child &c)
+      : c(c), fd(static_cast<int>(syscall(SYS_pidfd_open, c.pid, 0))) {}
+    ~handle() {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+    handle(const handle&) = delete;
+    handle& operator=(const handle&) = delete;
+    /* Kernels older than 5.3 have no `pidfd_open`, so we fall back to the
+     * canary. */
+    bool wait(int timeout, int wake) {
+      if (detail::poll_exit(fd != -1 ? fd : c.canary,
+          fd != -1 ? POLLIN : POLLHUP, timeout, wake)) {
+        detail::reap(c.pid);
+        return true;
+      }
+      return false;
+    }
+    child c;
+    int fd;
+  };
+};
+#endif
+
+/* There is no way to wait on a pid and a pipe at once, so we poll `waitpid`
+ * every ten milliseconds. */
+
+/* &#9824; */
+struct waitpid_exit {
+  struct handle {
+    explicit handle(const child &c) : c(c) {}
+    bool wait(int timeout, int wake) {
+      long long deadline = timeout < 0 ? -1 : monotonic() + timeout;
+      int status;
+      pid_t err;
+      for (;;) {
+        do {
+          err = waitpid(c.pid, &status, WNOHANG);
+        } while (err == -1 && errno == EINTR);
+        if (err == c.pid || (err == -1 && errno == ECHILD)) {
+          return true;
+        }
+        if (deadline >= 0 && monotonic() >= deadline) {
+          return false;
+        }
+        if (detail::poll_exit(wake, POLLIN, 10, -1)) {
+          return false;
+        }
+      }
+    }
+    child c;
+  };
+};
+
+/* ### Wait
+ *
+ * Each policy parks threads until a predicate on the state of the attendant
+ * holds or the deadline passes. The state is held in atomics, so the futex
+ * policy needs no mutex, and the condition variable policy only needs one to
+ * close the window between the test and the wait.
+ */
+
+/* &#9824; */
+class condvar_wait {
+public:
+  void notify() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cond_.notify_all();
+  }
+
+  template <class Predicate>
+  bool wait(long long deadline, Predicate predicate) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (deadline < 0) {
+      cond_.wait(lock, predicate);
+      return true;
+    }
+    return cond_.wait_for(lock,
+      std::chrono::milliseconds(std::max(0LL, deadline - monotonic())),
+      predicate);
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+#ifdef __linux__
+/* Waiters sleep on a generation count. A change of state after a waiter tests
+ * the predicate bumps the generation, so the futex wait returns at once. */
+
+/* &#9824; */
+class futex_wait {
+public:
+  void notify() {
+    generation_.fetch_add(1);
+    syscall(SYS_futex, &generation_, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+  }
+
+  template <class Predicate>
+  bool wait(long long deadline, Predicate predicate) {
+    struct timespec timespec, *timeout;
+    long long remaining;
+    unsigned generation;
+    for (;;) {
+      generation = generation_.load();
+      if (predicate()) {
+        return true;
+      }
+      timeout = NULL;
+      if (deadline >= 0) {
+        if ((remaining = deadline - monotonic()) <= 0) {
+          return false;
+        }
+        timespec.tv_sec = remaining / 1000;
+        timespec.tv_nsec = (remaining % 1000) * 1000000;
+        timeout = &timespec;
+      }
+      syscall(SYS_futex, &generation_, FUTEX_WAIT_PRIVATE, generation, timeout,
+        NULL, 0);
+    }
+  }
+
+private:
+  std::atomic<unsigned> generation_{0};
+};
+#endif
+
+/* ### Restart
+ *
+ * Given the uptime of the plugin server process that exited, return the
+ * milliseconds to wait before restarting, or `-1` to give up.
+ */
+
+/* &#9824; */
+struct always_restart {
+  int next(long long) { return 0; }
+};
+
+/* &#9824; */
+struct never_restart {
+  int next(long long) { return -1; }
+};
+
+/* Doubles the wait for each plugin server process that exits before it has run
+ * for the maximum wait, and starts over when one runs longer than that. */
+
+/* &#9824; */
+template <int Initial, int Maximum>
+struct backoff_restart {
+  int next(long long uptime) {
+    if (uptime > Maximum) {
+      crashes = 0;
+    }
+    if (crashes++ == 0) {
+      return 0;
+    }
+    long long wait = static_cast<long long>(Initial) << std::min(crashes - 2, 30);
+    return static_cast<int>(std::min<long long>(wait, Maximum));
+  }
+  int crashes = 0;
+};
+
+/* ### Attendant */
+
+/* &#9824; */
+template <class Spawn, class ExitDetect, class Wait, class Restart>
+class basic_attendant {
+public:
+  typedef void (*connector_t)(int in, int out);
+
+  basic_attendant(std::string relay, int canary_fd, connector_t connector,
+      Restart restart = Restart())
+    : relay_(std::move(relay)), canary_fd_(canary_fd), connector_(connector),
+      restart_(restart) {
+    if (pipe(wake_) == 0) {
+      fcntl(wake_[0], F_SETFD, FD_CLOEXEC);
+      fcntl(wake_[1], F_SETFD, FD_CLOEXEC);
+      fcntl(wake_[0], F_SETFL, fcntl(wake_[0], F_GETFL) | O_NONBLOCK);
+    }
+  }
+
+  basic_attendant(const basic_attendant&) = delete;
+  basic_attendant& operator=(const basic_attendant&) = delete;
+
+  /* If you did not wait on `done`, we obliterate the plugin server process. */
+  ~basic_attendant() {
+    if (supervisor_.joinable()) {
+      scram();
+      supervisor_.join();
+    }
+    close(wake_[0]);
+    close(wake_[1]);
+  }
+
+  /* Start the plugin server process and the thread that watches it. Call once.
+   */
+  void start(std::string path, std::vector<std::string> args) {
+    path_ = std::move(path);
+    args_ = std::move(args);
+    supervisor_ = std::thread(&basic_attendant::supervise, this);
+  }
+
+  /* Returns `1` when running, `0` if it never will again, or `not_yet` if the
+   * deadline passes. */
+  int ready(long long deadline = -1) {
+    if (! wait_.wait(deadline, [this] { return running_ || shutdown_; })) {
+      return not_yet;
+    }
+    return shutdown_ ? 0 : 1;
+  }
+
+  /* As with the C attendant, only the first thread to report the death of an
+   * instance asks for the restart. We send a `SIGTERM` and the supervisor will
+   * follow with a `SIGKILL` when the grace period passes. */
+  int retry(int millis, long long deadline = -1) {
+    int status;
+    bool terminate = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (instance_ == seen() && running_ && pid_ > 0) {
+        running_ = false;
+        terminate = true;
+        escalate_ = monotonic() + std::max(0, millis);
+        kill(pid_, SIGTERM);
+      }
+    }
+    if (terminate) {
+      wake();
+    }
+    if ((status = ready(deadline)) == 1) {
+      seen() = instance_;
+    }
+    return status;
+  }
+
+  /* The next exit is expected and final. You tell the plugin server process to
+   * exit yourself. */
+  void shutdown() {
+    shutdown_ = true;
+    wake();
+    wait_.notify();
+  }
+
+  /* Shutdown and kill the plugin server process immediately. */
+  void scram() {
+    shutdown();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pid_ > 0) {
+      kill(pid_, SIGKILL);
+    }
+  }
+
+  /* Wait for the supervisor to exit, after a shutdown. */
+  bool done(long long deadline = -1) {
+    if (! wait_.wait(deadline, [this] { return finished_.load(); })) {
+      return false;
+    }
+    if (supervisor_.joinable()) {
+      supervisor_.join();
+    }
+    return true;
+  }
+
+  /* The pipes of the running plugin server process. The supervisor closes them
+   * when the plugin server process exits. */
+  int in() const { return in_; }
+  int out() const { return out_; }
+  int err() const { return err_; }
+
+private:
+  /* The last instance this thread saw running, by attendant. We key by serial
+   * number, not address, so a new attendant at the address of an old one
+   * starts from scratch. */
+  int &seen() {
+    static thread_local std::unordered_map<unsigned long long, int> seen;
+    return seen.emplace(serial_, 1).first->second;
+  }
+
+  void wake() {
+    char ch = 0;
+    ssize_t err;
+    do {
+      err = write(wake_[1], &ch, 1);
+    } while (err == -1 && errno == EINTR);
+  }
+
+  void drain() {
+    char buffer[64];
+    while (read(wake_[0], buffer, sizeof(buffer)) > 0);
+  }
+
+  void close_pipes() {
+    for (std::atomic<int> *fd : { &in_, &out_, &err_, &canary_ }) {
+      int closing = fd->exchange(-1);
+      if (closing != -1) {
+        close(closing);
+      }
+    }
+  }
+
+  /* Launch the relay, through the spawn policy, and complete the same handshake
+   * as the C attendant. The relay writes the status pipe number to standard out
+   * and to the status pipe, then, if the exec of the plugin server program
+   * succeeds, the status pipe closes on exec. Otherwise we read an error. */
+  bool launch() {
+    int in[2], out[2], err[2], canary[2], status[2], message[2];
+    std::vector<std::string> strings;
+    std::vector<char*> argv;
+    plumbing p;
+    ssize_t size;
+    pid_t pid;
+
+    if (pipe(in) || pipe(out) || pipe(err) || pipe(canary) || pipe(status)) {
+      return false;
+    }
+    for (int fd : { in[1], out[0], err[0], canary[0], status[0] }) {
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    strings.push_back(relay_);
+    strings.push_back(std::to_string(status[1]));
+    strings.push_back(std::to_string(canary_fd_));
+    strings.push_back(path_);
+    strings.insert(strings.end(), args_.begin(), args_.end());
+    for (std::string &s : strings) {
+      argv.push_back(&s[0]);
+    }
+    argv.push_back(NULL);
+
+    p.in = in[0];
+    p.out = out[1];
+    p.err = err[1];
+    p.canary = canary[1];
+    p.canary_fd = canary_fd_;
+    pid = Spawn::spawn(relay_.c_str(), argv.data(), p);
+
+    for (int fd : { in[0], out[1], err[1], canary[1], status[1] }) {
+      close(fd);
+    }
+
+    in_ = in[1];
+    out_ = out[0];
+    err_ = err[0];
+    canary_ = canary[0];
+
+    if (pid <= 0) {
+      close(status[0]);
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pid_ = pid;
+    }
+
+    do {
+      size = read(out_, &message[0], sizeof(int));
+    } while (size == -1 && errno == EINTR);
+    if (size == sizeof(int)) {
+      do {
+        size = read(status[0], &message[0], sizeof(int));
+      } while (size == -1 && errno == EINTR);
+    }
+    if (size == sizeof(int)) {
+      do {
+        size = read(status[0], message, sizeof(message));
+      } while (size == -1 && errno == EINTR);
+      size = size == 0 ? sizeof(int) : 0;
+    }
+    close(status[0]);
+
+    return size == sizeof(int);
+  }
+
+  /* A launch that fails is final. A missing relay or plugin server program
+   * will not appear because we try again, and we would only fork forever. */
+  void supervise() {
+    long long started, timeout;
+    bool launched;
+    int chill;
+
+    for (;;) {
+      started = monotonic();
+      if ((launched = launch())) {
+        connector_(in_, out_);
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          instance_++;
+          running_ = true;
+        }
+        wait_.notify();
+
+        typename ExitDetect::handle handle(child{ pid_, canary_ });
+        for (;;) {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            timeout = escalate_ ? std::max(0LL, escalate_ - monotonic()) : -1;
+          }
+          if (handle.wait(static_cast<int>(std::min<long long>(timeout, INT_MAX)),
+              wake_[0])) {
+            break;
+          }
+          drain();
+          std::lock_guard<std::mutex> lock(mutex_);
+          if (escalate_ && monotonic() >= escalate_) {
+            kill(pid_, SIGKILL);
+            escalate_ = 0;
+          }
+        }
+      } else if (pid_ > 0) {
+        detail::reap(pid_);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pid_ = 0;
+        escalate_ = 0;
+        running_ = false;
+      }
+      close_pipes();
+      wait_.notify();
+
+      if (! launched || shutdown_ ||
+          (chill = restart_.next(monotonic() - started)) < 0) {
+        break;
+      }
+      if (chill) {
+        long long until = monotonic() + chill;
+        wait_.wait(until, [this] { return shutdown_.load(); });
+        if (shutdown_) {
+          break;
+        }
+      }
+    }
+
+    shutdown_ = true;
+    finished_ = true;
+    wait_.notify();
+  }
+
+  std::string relay_, path_;
+  std::vector<std::string> args_;
+  int canary_fd_;
+  connector_t connector_;
+  Restart restart_;
+  Wait wait_;
+  std::thread supervisor_;
+  std::mutex mutex_;
+  pid_t pid_ = 0;
+  long long escalate_ = 0;
+  std::atomic<int> in_{-1}, out_{-1}, err_{-1}, canary_{-1};
+  int wake_[2] = { -1, -1 };
+  std::atomic<int> instance_{0};
+  std::atomic<bool> running_{false}, shutdown_{false}, finished_{false};
+  const unsigned long long serial_ = next_serial();
+
+  static unsigned long long next_serial() {
+    static std::atomic<unsigned long long> serial{0};
+    return ++serial;
+  }
+};
+
+/* The closest thing to the C attendant. */
+typedef basic_attendant<fork_exec, canary_exit, condvar_wait, always_restart>
+  posix_attendant;
+
+} /* namespace attendant_cpp */
+
+#endif /* ATTENDANT_POLICY_HPP */
@@ -150,23 +150,43 @@
  */
 
 /* *Throw open Helicon now, goddesses, move your songs.* &mdash; Dante */
+#ifdef __linux__
+#define _GNU_SOURCE
+#include <sched.h>
+#endif
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
 #include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
+#ifdef __MACH__
+#include <mach/mach_time.h>
+#endif
 
 /* Local includes. */
 #include "attendant.h"
 #include "eintr.h"
 #include "errors.h"
 
+/* Darwin has no `MSG_NOSIGNAL`, we set `SO_NOSIGPIPE` on the socket instead. */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
 /* The abend handler will be called from a thread that is watching the process,
  * so if you supply a callback, be sure to be thread-safe.
  *
@@ -186,6 +206,12 @@ typedef void (*starter_t)(int restart, int uptime);
 /* TODO Document. */
 typedef void (*connector_t)(attendant__pipe_t in, attendant__pipe_t out);
 
+/* The callbacks of a plugin attendant created with `attendant_new`. */
+typedef void (*starter_r_t)(struct attendant__process *process, void *context,
+  int restart, int uptime);
+typedef void (*connector_r_t)(void *context, attendant__pipe_t in,
+  attendant__pipe_t out);
+
 /* ### Global State
  *
  * We have a collection of conditions used to alert blocking stub functions of a
@@ -206,12 +232,87 @@ struct cond {
 };
 
 
-/* The one and only process we watch. Static variables are gathered into this
- * structure so that when reading the code below, it is easy to see which are
- * static variables and which are local variables.*/
+/* A run of bytes that grows as needed. */
+struct buffer {
+  char *data;
+  size_t length;
+  size_t size;
+};
+
+/* The log that standard error and standard out go to, written only by the
+ * reaper thread. Bytes over the rate are spliced into `/dev/null`. */
+struct logbook {
+  char *path;
+  int fd;
+  int null;
+  long long size;
+  int keep;
+  long long rate;
+  /* The length of the log, the start of this second and what we have written
+   * and dropped in it. */
+  long long written;
+  long long second;
+  long long spent;
+  long long dropped;
+};
+
+/* A request remembered for replay, the frame header and all. */
+struct entry {
+  unsigned int id;
+  unsigned int flags;
+  size_t length;
+  char *frame;
+};
+
+/* The requests and replies carried by the reaper thread between the stable
+ * endpoint and the plugin server process. */
+
+/* &#9824; */
+struct journal {
+  /* The most requests we will remember, or zero if there is no endpoint. */
+  int capacity;
+  /* The requests we remember, oldest first. */
+  int count;
+  struct entry *entries;
+  /* The requests sent in full to the plugin server process, and the bytes
+   * sent of the one after. */
+  int sent;
+  size_t offset;
+  /* Bytes read from the plugin stub that do not yet make up a request, or
+   * that do but for which there is no room. */
+  struct buffer requests;
+  /* Bytes read from the plugin server process that do not yet make up a
+   * reply. */
+  struct buffer replies;
+  /* Replies on their way to the plugin stub. */
+  struct buffer outbound;
+/* &mdash; */
+};
+
+/* The longest name of a registered file descriptor, with its terminator. */
+#define HEIRLOOM_NAME 32
+
+/* The relay program passes fewer file descriptors than this, its own
+ * `PASSED_MAX`, counting the listener, the warm state, the blob and those
+ * inherited. */
+#define PASSED_MAX 64
+
+/* A file descriptor registered by the plugin server process for the next. */
+struct heirloom {
+  int fd;
+  char name[HEIRLOOM_NAME];
+};
+
+/* The number of crash times we remember. A crash limit greater than this is
+ * treated as this. */
+#define CRASH_RING 64
+
+/* The process we watch. Its state is gathered into this structure, so that
+ * when reading the code below, it is easy to see which are variables of the
+ * plugin attendant and which are local variables.*/
 
 /* &#9824; */
-struct process {
+struct attendant__process {
   /* Absolute path to the relay program. */
   char *relay;
   /* Arguments to pass to relay program, starting with the absolute path to the
@@ -226,8 +327,77 @@ struct process {
   time_t start_time;
   /* User supplied plugin stub to server process IPC initialization. */
   connector_t connector;
+  /* The same, given the handle and a user supplied context. */
+  starter_r_t starter_r;
+  connector_r_t connector_r;
+  void *context;
   /* SIGCHLD is not SIG_IGN so waitpid will block on specific pid. */
   short waitable;
+  /* Path of the UNIX domain socket of a shared plugin server process, or
+   * `NULL` if we do not share. */
+  char *rendezvous;
+  /* We are attached to a plugin server process launched by someone else. */
+  short attached;
+  /* The socket we listen on for the plugin server process, or -1, and its path,
+   * which we unlink when we are destroyed. */
+  int listener;
+  char *listening;
+  /* The stable endpoint, the plugin stub end first, or -1, and the requests
+   * and replies we are carrying through it. */
+  int endpoint[2];
+  struct journal journal;
+  /* The warm state region, shared by every plugin server process. */
+  int warm;
+  /* The sealed blob given to `start`, passed to every plugin server process
+   * until another is given. */
+  int blob;
+  /* The number of file descriptors passed before the canary, not counting the
+   * blob. */
+  int placed;
+  /* The plugin server process uses the companion library, it has a control
+   * socket and a heartbeat page, which we map too. */
+  int companion;
+  int page;
+  struct attendant__heartbeat *heartbeat;
+  /* Milliseconds without a heartbeat after which we restart the plugin server
+   * process, or zero for never. */
+  int watchdog;
+  /* The recycle policy, the last sample of the running plugin server process
+   * and the resource usage of the last to exit, guarded by the mutex. */
+  struct attendant__recycle recycle;
+  struct attendant__sample sample;
+  struct attendant__usage usage;
+  /* The pressure policy, the pressure stall triggers, memory some, memory
+   * full and CPU, each -1 if not registered, and what they have seen, guarded
+   * by the mutex. */
+  struct attendant__pressure pressure;
+  int triggers[3];
+  struct attendant__stress stress;
+  /* The last hang snapshot, guarded by the mutex, with no data if we take
+   * none. */
+  struct buffer snapshot;
+  /* Who owns standard out, and the ring of the last of standard error, whose
+   * length is every byte written to it since launch, guarded by the mutex,
+   * with no data if we keep none. */
+  int stdio;
+  struct buffer tail;
+  /* The log, whose file descriptors are -1 if there is none. */
+  struct logbook logbook;
+  /* The file descriptors registered for the next plugin server process, no
+   * more than `inherit` of them. */
+  int inherit;
+  int registered;
+  struct heirloom *registry;
+  /* Launch a dormant plugin server process on the first connection. */
+  short activate;
+  /* The thread that waits for that connection, if we have ever started one. */
+  pthread_t activator;
+  short activating;
+  /* A caller that cannot wait on the starter asked the activator thread to
+   * wake us. */
+  short summoned;
+  /* Initialization succeeded and we have not been destroyed. */
+  short initialized;
   /* The process pid. */
   pid_t pid;
   /* Server is running. */
@@ -241,6 +411,31 @@ struct process {
   /* A count of the number of times that the server has started and restarted.
    */
   int instance;
+  /* Crash loop policy from the initializer. */
+  struct attendant__backoff policy;
+  /* Monotonic times in milliseconds of the most recent crashes, a ring indexed
+   * by the count of crashes. */
+  long long crashes[CRASH_RING];
+  int crashed;
+  /* Monotonic time in milliseconds before which the next start must not launch,
+   * or zero if we are not chilling. */
+  long long chilled;
+  /* The crash loop circuit is open. */
+  short tripped;
+  /* Seed for the backoff jitter. */
+  unsigned seed;
+  /* Milliseconds without a call to `ready` or `retry` before we stop the
+   * plugin server process, or zero for never. */
+  int idle;
+  /* Monotonic time in milliseconds of the last call to `ready` or `retry`. */
+  long long active;
+  /* The reaper is stopping the plugin server process for idleness. */
+  short idling;
+  /* The reaper is stopping a worn plugin server process to recycle it. */
+  short recycling;
+  /* The plugin server process is not running and will be launched by the next
+   * call to `ready` or `retry`. */
+  short dormant;
   /* The attendant error code and system error code for last thing that went
    * wrong. */
   struct attendant__errors errors;
@@ -255,18 +450,24 @@ struct process {
   pthread_t launcher;
   /* The server process reaper thread. */
   pthread_t reaper;
-  /* We create seven pipes, so we create an array of seven pipe pairs. We then
+  /* We create eleven pipes, so we create an array of eleven pipe pairs. We then
    * refer to the pipes by name in code using the defines below that map the
    * pipe name to a pipe index. */
-  attendant__pipe_t pipes[7][2];            
+  attendant__pipe_t pipes[11][2];            
+#ifdef __linux__
+  /* The CPUs a plugin server process in a pool is pinned to, if pinned. */
+  cpu_set_t affinity;
+  short pinned;
+#endif
   /* &mdash; */
 };
 
-/* The variable structure for our once and only instance of the plugin
- * attendant. */
+/* The variable structure for the default instance of the plugin attendant, the
+ * one behind `struct attendant`. Those created by `attendant_new` are
+ * allocated. */
 
 /* &mdash; */
-static struct process process;
+static struct attendant__process singleton;
 
 /* ### Pipes
  *
@@ -322,11 +523,47 @@ static struct process process;
 /* &mdash; */
 #define PIPE_REAPER   6
 
-/* Process is one static structure, one process launched per library. It would
- * be easy enough to make this an API that has a handle, but if you did want to
- * run and watch a handful of server processes, it would better to make the
- * first process you launch that monitor, because you'll have complete control
- * over the environment, and your process monitoring strategy can take the shape
+/* The notify pipe is for the host application event loop. We write a byte to
+ * it at every change of state, so that the plugin stub can poll the read end
+ * instead of parking a thread in a blocking call. Both ends are non-blocking.
+ * If the pipe is full, the event loop has yet to look, and one more byte would
+ * tell it nothing new. Like the reaper pipe, it lives for the life of the
+ * plugin attendant.
+ */
+
+/* &mdash; */
+#define PIPE_NOTIFY   7
+
+/* The activate pipe wakes the activator thread when the plugin attendant is no
+ * longer dormant, so that it can stop waiting for a connection. It lives for
+ * the life of the plugin attendant.
+ */
+
+/* &mdash; */
+#define PIPE_ACTIVATE 8
+
+/* The registry socket is not a pipe, but a pair of datagram sockets, created at
+ * each launch, on which the plugin server process sends file descriptors for
+ * its successors. The reaper thread receives them.
+ */
+
+/* &mdash; */
+#define PIPE_REGISTRY 9
+
+/* The control socket is a pair of stream sockets, created at each launch for a
+ * plugin server process that uses the companion library. It says that it is
+ * ready and we say that it should shut down.
+ */
+
+/* &mdash; */
+#define PIPE_CONTROL 10
+
+/* Every function below takes the process structure it works on, so the one
+ * static structure is merely the default, and `attendant_new` hands out more.
+ * They share no state, so they need share no locks. Still, if you want to run
+ * and watch a handful of server processes, it would better to make the first
+ * process you launch that monitor, because you'll have complete control over
+ * the environment, and your process monitoring strategy can take the shape
  * that best suits the needs of your application.
  *
  * All we're trying to do here is get one process cleanly spun off form the host
@@ -352,11 +589,17 @@ extern void say(const char* format, ...);
 #define FAIL(cond, message, label) \
   do { \
     if (cond) { \
-      set_error(message); \
+      set_error(process, message); \
       goto label; \
     } \
   } while (0)
 
+/* Start a thread to wait for a connection while we are dormant. */
+static void arm(struct attendant__process *process);
+
+/* Open the log at its end. */
+static int open_log(struct attendant__process *process);
+
 /* Does nothing. Launched at initialization using the reaper thread handle, so
  * that the initial launcher has a reaper thread to join. */
 static void* kickoff(void *data) {
@@ -364,53 +607,87 @@ static void* kickoff(void *data) {
 }
 
 /* Close a pipe if it is not already closed. */
-static void close_pipe(int pipeno, int direction) {
-  if (process.pipes[pipeno][direction] != -1) {
-    close(process.pipes[pipeno][direction]);
-    process.pipes[pipeno][direction] = -1;
+static void close_pipe(struct attendant__process *process, int pipeno,
+    int direction) {
+  if (process->pipes[pipeno][direction] != -1) {
+    close(process->pipes[pipeno][direction]);
+    process->pipes[pipeno][direction] = -1;
+  }
+}
+
+/* A file descriptor the plugin attendant holds must not be the canary, which is
+ * duplicated over it after fork. Returns the file descriptor, moved if need be,
+ * or -1 if it could not be moved. */
+static int sidestep(struct attendant__process *process, int fd) {
+  int moved;
+  if (fd == -1 || fd != process->canary) {
+    return fd;
   }
+  moved = fcntl(fd, F_DUPFD, process->canary + 1);
+  close(fd);
+  if (moved != -1) {
+    fcntl(moved, F_SETFD, FD_CLOEXEC);
+  }
+  return moved;
 }
 
 /* Record the given plugin attendant error code along with the current system
  * error number. */
-static void set_error(int error) {
-  if (process.errors.attendant == 0) {
-    process.errors.attendant = error;
-    process.errors.system = errno;
+static void set_error(struct attendant__process *process, int error) {
+  if (process->errors.attendant == 0) {
+    process->errors.attendant = error;
+    process->errors.system = errno;
   }
 }
 
+/* Tell the host application event loop that our state has changed. Called
+ * wherever we wake the threads waiting on a change of state. */
+static void notify(struct attendant__process *process) {
+  int err;
+  char ch = 0;
+  HANDLE_EINTR(write(process->pipes[PIPE_NOTIFY][1], &ch, 1), err);
+}
+
 /* `initalize` &mdash; Called as the dynamic library is loaded. Must be called
  * before the plugin server process can be started.
  */
 
 /* &#9824; */
-static int initalize(struct attendant__initializer *initializer)
+static int initalize(struct attendant__process *process,
+    struct attendant__initializer *initializer)
 {
   struct sigaction sigchld;
+  struct sockaddr_un address;
+  struct stat stat;
+  struct attendant__warm warm;
   pthread_condattr_t attr;
-  int i, pipeno, err;
-
-  /* Otherwise, what's the point? */
-  FAIL(initializer->starter == NULL, INITIALIZE_STARTER_REQUIRED, fail);
-  process.starter = initializer->starter;
-
-  FAIL(initializer->connector == NULL, INITIALIZE_CONNECTOR_REQUIRED, fail);
-  process.connector = initializer->connector;
-
-  /* The user gets to chose the canary file descriptor on UNIX. */
-  process.canary = initializer->canary;
-
-  /* Take note of the location of the relay program. */
-  process.relay = strdup(initializer->relay);
+  char *runtime;
+#ifndef __linux__
+  char temporary[32];
+#else
+  char trigger[64];
+  int thresholds[3];
+#endif
+  int i, pipeno, err, placed;
 
-  /* Initialize the pipes to -1, so we know that they are not open. */
-  for (i = PIPE_STDIN; i <= PIPE_REAPER; i++) {
-    process.pipes[i][0] = process.pipes[i][1] = -1;
+  /* Initialize the pipes to -1, so we know that they are not open. We do this
+   * and create our mutex, conditions and key before anything can fail, so
+   * that a failure can release all of them. */
+  for (i = PIPE_STDIN; i <= PIPE_CONTROL; i++) {
+    process->pipes[i][0] = process->pipes[i][1] = -1;
   }
+  process->listener = -1;
+  process->warm = -1;
+  process->blob = -1;
+  process->page = -1;
+  process->endpoint[0] = process->endpoint[1] = -1;
+  for (i = 0; i < 3; i++) {
+    process->triggers[i] = -1;
+  }
+  process->logbook.fd = process->logbook.null = -1;
 
   /* Create our mutex and signaling device. */
-  (void) pthread_mutex_init(&process.mutex, NULL);
+  (void) pthread_mutex_init(&process->mutex, NULL);
 
   /* Initialize thread conditions. These are used to by threads to wait for
    * another thread to change the state of static variables.
@@ -437,16 +714,59 @@ static int initalize(struct attendant__initializer *initializer)
   (void) pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
 #endif
 
-  (void) pthread_cond_init(&process.cond.running, &attr);
-  (void) pthread_cond_init(&process.cond.chilling, &attr);
-  (void) pthread_cond_init(&process.cond.shutdown, &attr);
-  (void) pthread_cond_init(&process.cond.getgpid, &attr);
+  (void) pthread_cond_init(&process->cond.running, &attr);
+  (void) pthread_cond_init(&process->cond.chilling, &attr);
+  (void) pthread_cond_init(&process->cond.shutdown, &attr);
+  (void) pthread_cond_init(&process->cond.getgpid, &attr);
 
   (void) pthread_condattr_destroy (&attr);
 
   /* Initialize the thread local storage key used to track the instance count
    * when a plugin stub threads invokes `retry`. */
-  (void) pthread_key_create(&process.key, free);
+  (void) pthread_key_create(&process->key, free);
+
+  /* Otherwise, what's the point? */
+  FAIL(initializer->starter == NULL && initializer->starter_r == NULL,
+    INITIALIZE_STARTER_REQUIRED, fail);
+  process->starter = initializer->starter;
+  process->starter_r = initializer->starter_r;
+
+  FAIL(initializer->connector == NULL && initializer->connector_r == NULL,
+    INITIALIZE_CONNECTOR_REQUIRED, fail);
+  process->connector = initializer->connector;
+  process->connector_r = initializer->connector_r;
+  process->context = initializer->context;
+
+  /* The user gets to chose the canary file descriptor on UNIX. */
+  process->canary = initializer->canary;
+
+  /* Take note of the crash loop policy. */
+  process->policy = initializer->backoff;
+  if (process->policy.limit > CRASH_RING) {
+    process->policy.limit = CRASH_RING;
+  }
+  process->seed = (unsigned) getpid() ^ (unsigned) time(NULL);
+
+  /* Take note of the demand policy. A lazy plugin attendant is dormant until
+   * the first call to `ready`. */
+  process->idle = initializer->idle;
+  process->dormant = initializer->lazy != 0;
+
+  /* Take note of the location of the relay program. */
+  process->relay = strdup(initializer->relay);
+
+  /* Resolve the path of a shared plugin server process. Without a runtime
+   * directory, there is nowhere private to meet, so we do not share. We do
+   * this once everything that a failure releases is in a state to release. */
+  if (initializer->rendezvous[0] != '\0'
+      && (runtime = getenv("XDG_RUNTIME_DIR")) != NULL) {
+    process->rendezvous = malloc(sizeof(address.sun_path));
+    FAIL(process->rendezvous == NULL, INITIALIZE_CANNOT_MALLOC, fail);
+    err = snprintf(process->rendezvous, sizeof(address.sun_path), "%s/%s",
+      runtime, initializer->rendezvous);
+    FAIL(err < 0 || err >= sizeof(address.sun_path),
+      INITIALIZE_RENDEZVOUS_TOO_LONG, fail);
+  }
 
   /* If the state of SIGCHLD is SIG_IGN the host application wants the kernel to
    * take care of zombies, and waitpid is usless for our purposes.
@@ -469,40 +789,265 @@ static int initalize(struct attendant__initializer *initializer)
 
   /* Determine if the SIGCHILD is ignored. */
   sigaction(SIGCHLD, NULL, &sigchld);
-  process.waitable = sigchld.sa_handler != SIG_IGN;
+  process->waitable = sigchld.sa_handler != SIG_IGN;
 
   /* The plugin stub will wait for ready, so instance will be one or more before
    * retry is called. */
-  process.instance = 0;
+  process->instance = 0;
 
   /* Nope. Only after the initial call to start. */
-  process.running = 0;
-
-  /* Ensure that the launcher thread has a reaper thread to join. */
-  pthread_create(&process.reaper, NULL, kickoff, NULL);
+  process->running = 0;
 
   /* We will preserve the same file descriptors on the plugin stub end of the
    * stdio pipes between restarts. The launcher thread is going to expect a
    * previous set, so we create it here to get the ball rolling. */
   for (pipeno = PIPE_STDIN; pipeno <= PIPE_STDERR; pipeno++) {
-    err = pipe(process.pipes[pipeno]);
+    err = pipe(process->pipes[pipeno]);
     FAIL(err == -1, INITIALIZE_CANNOT_CREATE_STDIN_PIPE + pipeno, fail);
   }
 
   /* We can close the file descriptors of the plugin server side now. We're not
    * going to actually use these particular pipes. */
-  close_pipe(PIPE_STDIN, 0);
-  close_pipe(PIPE_STDOUT, 1);
-  close_pipe(PIPE_STDERR, 1);
+  close_pipe(process, PIPE_STDIN, 0);
+  close_pipe(process, PIPE_STDOUT, 1);
+  close_pipe(process, PIPE_STDERR, 1);
 
   /* Create the instance pipe, which will remain open until the plugin attendant
    * is destroyed. */
-  err = pipe(process.pipes[PIPE_REAPER]);
+  err = pipe(process->pipes[PIPE_REAPER]);
   FAIL(err == -1, INITIALIZE_CANNOT_CREATE_REAPER_PIPE, fail);
 
   /* No child process should inherit the instance pipe. */
-  fcntl(process.pipes[PIPE_REAPER][0], F_SETFD, FD_CLOEXEC);
-  fcntl(process.pipes[PIPE_REAPER][1], F_SETFD, FD_CLOEXEC);
+  fcntl(process->pipes[PIPE_REAPER][0], F_SETFD, FD_CLOEXEC);
+  fcntl(process->pipes[PIPE_REAPER][1], F_SETFD, FD_CLOEXEC);
+
+  /* Create the notify pipe. No child should inherit it either. */
+  err = pipe(process->pipes[PIPE_NOTIFY]);
+  FAIL(err == -1, INITIALIZE_CANNOT_CREATE_NOTIFY_PIPE, fail);
+
+  for (i = 0; i < 2; i++) {
+    fcntl(process->pipes[PIPE_NOTIFY][i], F_SETFD, FD_CLOEXEC);
+    fcntl(process->pipes[PIPE_NOTIFY][i], F_SETFL,
+      fcntl(process->pipes[PIPE_NOTIFY][i], F_GETFL) | O_NONBLOCK);
+  }
+
+  /* Create the stable endpoint. Our end is non-blocking, because the reaper
+   * thread must never wait on the plugin stub. */
+  if (initializer->journal > 0) {
+    err = socketpair(AF_UNIX, SOCK_STREAM, 0, process->endpoint);
+    FAIL(err == -1, INITIALIZE_CANNOT_CREATE_ENDPOINT, fail);
+    fcntl(process->endpoint[0], F_SETFD, FD_CLOEXEC);
+    fcntl(process->endpoint[1], F_SETFD, FD_CLOEXEC);
+    fcntl(process->endpoint[1], F_SETFL,
+      fcntl(process->endpoint[1], F_GETFL) | O_NONBLOCK);
+    process->journal.entries = calloc(initializer->journal,
+      sizeof(struct entry));
+    FAIL(process->journal.entries == NULL, INITIALIZE_CANNOT_CREATE_ENDPOINT,
+      fail);
+    process->journal.capacity = initializer->journal;
+  }
+
+  /* The plugin server process is passed file descriptors starting at 3, the
+   * listener, the warm state, any blob, those left by its predecessors, then
+   * the registry socket, the control socket and the heartbeat page, so the
+   * canary must be above them all. We check for the blob when we are given
+   * one. */
+  placed = (initializer->listener[0] != '\0') + (initializer->warm > 0);
+
+  /* The relay program would refuse to pass more than it can, but only once
+   * that many had been registered, far from the cause, so we refuse now. We
+   * leave room for a blob, which we do not know of yet. */
+  FAIL(initializer->inherit > PASSED_MAX - 1 - placed - 1,
+    INITIALIZE_TOO_MANY_INHERITED, fail);
+
+  placed += (initializer->inherit > 0 ? initializer->inherit + 1 : 0)
+    + (initializer->companion ? 2 : 0);
+  FAIL(process->canary >= 3 && process->canary < 3 + placed,
+    INITIALIZE_CANARY_IS_LISTEN_FD, fail);
+  process->placed = placed;
+
+  /* Create the heartbeat page of the companion library. It is ours, so we
+   * map it once, and the plugin server process maps it at each launch. */
+  if (initializer->companion) {
+#ifdef __linux__
+    process->page = memfd_create("attendant", MFD_CLOEXEC);
+#else
+    strcpy(temporary, "/tmp/attendant.XXXXXX");
+    process->page = mkstemp(temporary);
+    if (process->page != -1) {
+      unlink(temporary);
+      fcntl(process->page, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    process->page = sidestep(process, process->page);
+    FAIL(process->page == -1, INITIALIZE_CANNOT_CREATE_HEARTBEAT, fail);
+    err = ftruncate(process->page, sysconf(_SC_PAGESIZE));
+    FAIL(err == -1, INITIALIZE_CANNOT_CREATE_HEARTBEAT, fail);
+    process->heartbeat = mmap(NULL, sysconf(_SC_PAGESIZE),
+      PROT_READ | PROT_WRITE, MAP_SHARED, process->page, 0);
+    FAIL(process->heartbeat == MAP_FAILED, INITIALIZE_CANNOT_CREATE_HEARTBEAT,
+      fail);
+    process->companion = 1;
+    process->watchdog = initializer->watchdog;
+  }
+
+  /* Sampling is for Linux, which has `/proc`. */
+#ifdef __linux__
+  process->recycle = initializer->recycle;
+#endif
+
+  /* As are pressure stall triggers. A trigger is written as the kind of stall,
+   * the stall and the window in microseconds, and the kernel wants the
+   * terminating null. */
+#ifdef __linux__
+  if (initializer->pressure.window) {
+    thresholds[0] = initializer->pressure.some;
+    thresholds[1] = initializer->pressure.full;
+    thresholds[2] = initializer->pressure.cpu;
+    for (i = 0; i < 3; i++) {
+      if (thresholds[i] == 0) {
+        continue;
+      }
+      HANDLE_EINTR(open(i == 2 ? "/proc/pressure/cpu"
+        : "/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC),
+        process->triggers[i]);
+      process->triggers[i] = sidestep(process, process->triggers[i]);
+      FAIL(process->triggers[i] == -1, INITIALIZE_CANNOT_CREATE_TRIGGER, fail);
+      err = snprintf(trigger, sizeof(trigger), "%s %d %d",
+        i == 1 ? "full" : "some", thresholds[i] * 1000,
+        initializer->pressure.window * 1000);
+      HANDLE_EINTR(write(process->triggers[i], trigger, err + 1), err);
+      FAIL(err == -1, INITIALIZE_CANNOT_CREATE_TRIGGER, fail);
+    }
+    process->pressure = initializer->pressure;
+  }
+#endif
+
+  /* Make room for the hang snapshot. */
+  if (initializer->snapshot > 0) {
+    process->snapshot.data = malloc(initializer->snapshot);
+    FAIL(process->snapshot.data == NULL, INITIALIZE_CANNOT_CREATE_SNAPSHOT,
+      fail);
+    process->snapshot.size = initializer->snapshot;
+    process->snapshot.length = 0;
+  }
+
+  /* And for the tail of standard error. */
+  process->stdio = initializer->stdio;
+  if (initializer->tail > 0) {
+    process->tail.data = malloc(initializer->tail);
+    FAIL(process->tail.data == NULL, INITIALIZE_CANNOT_CREATE_TAIL, fail);
+    process->tail.size = initializer->tail;
+    process->tail.length = 0;
+  }
+
+  /* Open the log. We need `/dev/null` only to drop what is over the rate. */
+  if (initializer->logging.path[0] != '\0') {
+    process->logbook.path = strdup(initializer->logging.path);
+    FAIL(process->logbook.path == NULL, INITIALIZE_CANNOT_OPEN_LOG, fail);
+    process->logbook.size = initializer->logging.size;
+    process->logbook.keep = initializer->logging.keep;
+    process->logbook.rate = initializer->logging.rate;
+    process->logbook.second = process->logbook.spent = 0;
+    process->logbook.dropped = 0;
+    FAIL(open_log(process) == -1, INITIALIZE_CANNOT_OPEN_LOG, fail);
+    if (process->logbook.rate) {
+      HANDLE_EINTR(open("/dev/null", O_WRONLY | O_CLOEXEC),
+        process->logbook.null);
+      process->logbook.null = sidestep(process, process->logbook.null);
+      FAIL(process->logbook.null == -1, INITIALIZE_CANNOT_OPEN_LOG, fail);
+    }
+  }
+
+  /* Make room for the file descriptors left to the next plugin server
+   * process. */
+  if (initializer->inherit > 0) {
+    process->registry = calloc(initializer->inherit, sizeof(struct heirloom));
+    FAIL(process->registry == NULL, INITIALIZE_CANNOT_CREATE_REGISTRY, fail);
+    process->inherit = initializer->inherit;
+  }
+
+  /* Create the warm state. It is ours, so it outlives every plugin server
+   * process, and it is anonymous, so it goes when we go. We write a header
+   * that says that nothing has been built. */
+  if (initializer->warm > 0) {
+    FAIL(initializer->warm < ATTENDANT_WARM_HEADER,
+      INITIALIZE_CANNOT_CREATE_WARM_STATE, fail);
+#ifdef __linux__
+    process->warm = memfd_create("attendant", MFD_CLOEXEC);
+#else
+    strcpy(temporary, "/tmp/attendant.XXXXXX");
+    process->warm = mkstemp(temporary);
+    if (process->warm != -1) {
+      unlink(temporary);
+      fcntl(process->warm, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+    process->warm = sidestep(process, process->warm);
+    FAIL(process->warm == -1, INITIALIZE_CANNOT_CREATE_WARM_STATE, fail);
+    err = ftruncate(process->warm, initializer->warm);
+    FAIL(err == -1, INITIALIZE_CANNOT_CREATE_WARM_STATE, fail);
+    memset(&warm, 0, sizeof(warm));
+    warm.magic = ATTENDANT_WARM_MAGIC;
+    warm.size = initializer->warm;
+    HANDLE_EINTR(pwrite(process->warm, &warm, sizeof(warm), 0), err);
+    FAIL(err != sizeof(warm), INITIALIZE_CANNOT_CREATE_WARM_STATE, fail);
+  }
+
+  /* Listen on behalf of the plugin server process. The socket is ours for as
+   * long as we live, so that connections wait out a restart in the backlog.
+   * The plugin server process gets it at file descriptor 3. */
+  if (initializer->listener[0] != '\0') {
+    FAIL(strlen(initializer->listener) >= sizeof(address.sun_path),
+      INITIALIZE_LISTENER_TOO_LONG, fail);
+
+    process->listener = sidestep(process, socket(AF_UNIX, SOCK_STREAM, 0));
+    FAIL(process->listener == -1, INITIALIZE_CANNOT_LISTEN, fail);
+    fcntl(process->listener, F_SETFD, FD_CLOEXEC);
+
+    /* A socket left behind by a plugin attendant that did not get to clean up
+     * would make bind fail, but we remove nothing that is not a socket. */
+    if (lstat(initializer->listener, &stat) == 0 && S_ISSOCK(stat.st_mode)) {
+      unlink(initializer->listener);
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, initializer->listener);
+    err = bind(process->listener, (struct sockaddr *) &address,
+      sizeof(address));
+    FAIL(err == -1, INITIALIZE_CANNOT_LISTEN, fail);
+    process->listening = strdup(initializer->listener);
+
+    err = listen(process->listener, SOMAXCONN);
+    FAIL(err == -1, INITIALIZE_CANNOT_LISTEN, fail);
+
+    process->activate = initializer->activate != 0;
+  }
+
+  /* The activate pipe is only needed if we can be dormant, when the activator
+   * thread waits for a connection or for a caller that cannot wait on the
+   * starter. */
+  if (process->dormant || process->idle > 0 || process->activate) {
+    err = pipe(process->pipes[PIPE_ACTIVATE]);
+    FAIL(err == -1, INITIALIZE_CANNOT_CREATE_ACTIVATE_PIPE, fail);
+    for (i = 0; i < 2; i++) {
+      fcntl(process->pipes[PIPE_ACTIVATE][i], F_SETFD, FD_CLOEXEC);
+      fcntl(process->pipes[PIPE_ACTIVATE][i], F_SETFL,
+        fcntl(process->pipes[PIPE_ACTIVATE][i], F_GETFL) | O_NONBLOCK);
+    }
+  }
+
+  /* Ensure that the launcher thread has a reaper thread to join. We do this
+   * last, so that a failure above leaves no thread behind. */
+  pthread_create(&process->reaper, NULL, kickoff, NULL);
+
+  /* A lazy plugin attendant waits for a connection or a summons now. */
+  if (process->dormant) {
+    arm(process);
+  }
+
+  process->initialized = 1;
 
   say("[initialize/success]");
 
@@ -511,17 +1056,105 @@ static int initalize(struct attendant__initializer *initializer)
 
 fail:
   /* If we fail, then we close any pipes we might have opened. */
-  close_pipe(PIPE_STDIN, 0);
-  close_pipe(PIPE_STDIN, 1);
+  close_pipe(process, PIPE_STDIN, 0);
+  close_pipe(process, PIPE_STDIN, 1);
+
+  close_pipe(process, PIPE_STDOUT, 0);
+  close_pipe(process, PIPE_STDOUT, 1);
+
+  close_pipe(process, PIPE_STDERR, 0);
+  close_pipe(process, PIPE_STDERR, 1);
+
+  close_pipe(process, PIPE_REAPER, 0);
+  close_pipe(process, PIPE_REAPER, 1);
+
+  close_pipe(process, PIPE_NOTIFY, 0);
+  close_pipe(process, PIPE_NOTIFY, 1);
+
+  close_pipe(process, PIPE_ACTIVATE, 0);
+  close_pipe(process, PIPE_ACTIVATE, 1);
+
+  /* And we close the endpoint. */
+  for (i = 0; i < 2; i++) {
+    if (process->endpoint[i] != -1) {
+      close(process->endpoint[i]);
+      process->endpoint[i] = -1;
+    }
+  }
+  free(process->journal.entries);
+  process->journal.entries = NULL;
+  process->journal.capacity = 0;
+
+  /* And the registry. */
+  free(process->registry);
+  process->registry = NULL;
+  process->inherit = 0;
+
+  /* And the warm state. */
+  if (process->warm != -1) {
+    close(process->warm);
+    process->warm = -1;
+  }
+
+  /* And the heartbeat page. */
+  if (process->heartbeat != NULL && process->heartbeat != MAP_FAILED) {
+    munmap(process->heartbeat, sysconf(_SC_PAGESIZE));
+  }
+  process->heartbeat = NULL;
+  if (process->page != -1) {
+    close(process->page);
+    process->page = -1;
+  }
+  process->companion = 0;
+
+  /* And the pressure stall triggers. */
+  for (i = 0; i < 3; i++) {
+    if (process->triggers[i] != -1) {
+      close(process->triggers[i]);
+      process->triggers[i] = -1;
+    }
+  }
 
-  close_pipe(PIPE_STDOUT, 0);
-  close_pipe(PIPE_STDOUT, 1);
+  /* And the hang snapshot and the tail. */
+  free(process->snapshot.data);
+  memset(&process->snapshot, 0, sizeof(process->snapshot));
+  free(process->tail.data);
+  memset(&process->tail, 0, sizeof(process->tail));
 
-  close_pipe(PIPE_STDERR, 0);
-  close_pipe(PIPE_STDERR, 1);
+  /* And the log. */
+  if (process->logbook.fd != -1) {
+    close(process->logbook.fd);
+  }
+  if (process->logbook.null != -1) {
+    close(process->logbook.null);
+  }
+  free(process->logbook.path);
+  memset(&process->logbook, 0, sizeof(process->logbook));
+  process->logbook.fd = process->logbook.null = -1;
+
+  /* And we stop listening. */
+  if (process->listener != -1) {
+    close(process->listener);
+    process->listener = -1;
+  }
+  if (process->listening) {
+    unlink(process->listening);
+    free(process->listening);
+    process->listening = NULL;
+  }
 
-  close_pipe(PIPE_REAPER, 0);
-  close_pipe(PIPE_REAPER, 1);
+  /* And the paths, the key, the mutex and the conditions, so that a failed
+   * plugin attendant holds nothing and need not be destroyed. */
+  free(process->relay);
+  process->relay = NULL;
+  free(process->rendezvous);
+  process->rendezvous = NULL;
+  pthread_key_delete(process->key);
+  pthread_mutex_destroy(&process->mutex);
+  pthread_cond_destroy(&process->cond.running);
+  pthread_cond_destroy(&process->cond.chilling);
+  pthread_cond_destroy(&process->cond.shutdown);
+  pthread_cond_destroy(&process->cond.getgpid);
 
   return -1;
 /* &mdash; */
@@ -566,10 +1199,13 @@ void pthread_cond_waitforabit(pthread_cond_t *cond, pthread_mutex_t *mutex,
     timespec.tv_nsec = (millis % 1000) * 1000000;
     pthread_cond_timedwait_relative_np(cond, mutex, &timespec);
 #else
-    clock_gettime(CLOCK_MONOTONIC, timespec);
-    timespec.tv_nsec += millis  * 1000000;
-    timespec.tv_sec += timespec.tv_nsec / 1000000000;
-    timespec.tv_nsec += timespec.tv_nsec % 1000000000;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+    timespec.tv_sec += millis / 1000;
+    timespec.tv_nsec += (long) (millis % 1000) * 1000000;
+    if (timespec.tv_nsec >= 1000000000) {
+      timespec.tv_sec++;
+      timespec.tv_nsec -= 1000000000;
+    }
     pthread_cond_timedwait(cond, mutex, &timespec);
 #endif
   } else {
@@ -577,6 +1213,43 @@ void pthread_cond_waitforabit(pthread_cond_t *cond, pthread_mutex_t *mutex,
   }
 }
 
+/* Returns the time of the monotonic clock in milliseconds. Used for waits that
+ * must survive spurious wake ups, and for the crash loop window. */
+static long long monotonic() {
+#ifdef __MACH__
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0) {
+    mach_timebase_info(&timebase);
+  }
+  return mach_absolute_time() * timebase.numer / timebase.denom / 1000000;
+#else
+  struct timespec timespec;
+  clock_gettime(CLOCK_MONOTONIC, &timespec);
+  return timespec.tv_sec * 1000LL + timespec.tv_nsec / 1000000;
+#endif
+}
+
+/* Wait on a condition until an absolute deadline of the monotonic clock, or
+ * forever if the deadline is negative. Returns false if the deadline has
+ * passed, in which case we did not wait at all. The caller loops, checking its
+ * invariants, and so it waits out the full time in spite of spurious wake ups.
+ */
+static int pthread_cond_waituntil(pthread_cond_t *cond, pthread_mutex_t *mutex,
+    long long deadline) {
+  long long remaining;
+  if (deadline < 0) {
+    pthread_cond_wait(cond, mutex);
+    return 1;
+  }
+  remaining = deadline - monotonic();
+  if (remaining <= 0) {
+    return 0;
+  }
+  pthread_cond_waitforabit(cond, mutex,
+    remaining > INT_MAX ? INT_MAX : (int) remaining);
+  return 1;
+}
+
 /* ### Start */
 
 /* The start function calls the launch function. */ 
@@ -584,7 +1257,9 @@ static void* launch(void *data);
 /* The launch function calls the reap function. */ 
 static void* reap(void *data);
 /* Called by start, launch and reap. */
-static void signal_termination();
+static void signal_termination(struct attendant__process *process);
+/* Called by the activator thread. */
+static void awaken(struct attendant__process *process);
 
 /* Free the copy we made of the plugin server program name and arguments to pass
  * to the to the plugin server process.
@@ -593,15 +1268,18 @@ static void signal_termination();
  * number. We don't know that number when we make our copy of the client
  * supplied arguments, so we leave it null. We always have at least four
  * arguments in the array, so we can safely skip the second argument when it is
- * null, because it can never be the array terminator.
+ * null, because it can never be the array terminator. Then free the array
+ * itself, which `start` allocates anew each time.
  */
-static void free_argv() {
+static void free_argv(struct attendant__process *process) {
   int i;
-  if (process.argv) {
-    for (i = 0; process.argv[i] || i == 1; i++) {
-      free(process.argv[i]);
-      process.argv[i] = NULL;
+  if (process->argv) {
+    for (i = 0; process->argv[i] || i == 1; i++) {
+      free(process->argv[i]);
+      process->argv[i] = NULL;
     }
+    free(process->argv);
+    process->argv = NULL;
   }
 }
 
@@ -611,15 +1289,19 @@ static void free_argv() {
  * the plugin stub side of stdio between restarts, so that the plugin stub can
  * cache the file descriptors.
  */
-static void close_pipes() {
+static void close_pipes(struct attendant__process *process) {
   int pipeno;
-  close_pipe(PIPE_STDIN, 0);
-  close_pipe(PIPE_STDOUT, 1);
-  close_pipe(PIPE_STDERR, 1);
+  close_pipe(process, PIPE_STDIN, 0);
+  close_pipe(process, PIPE_STDOUT, 1);
+  close_pipe(process, PIPE_STDERR, 1);
   for (pipeno = PIPE_FORK; pipeno <= PIPE_CANARY; pipeno++) {
-    close_pipe(pipeno, 0);
-    close_pipe(pipeno, 1);
+    close_pipe(process, pipeno, 0);
+    close_pipe(process, pipeno, 1);
   }
+  close_pipe(process, PIPE_REGISTRY, 0);
+  close_pipe(process, PIPE_REGISTRY, 1);
+  close_pipe(process, PIPE_CONTROL, 0);
+  close_pipe(process, PIPE_CONTROL, 1);
 }
 
 /* The `start` function is called first at library load, then subsequently from
@@ -641,22 +1323,94 @@ static void close_pipes() {
  */
 
 /* &mdash; */
-static int start(const char* path, char const* argv[], int wait)
+int attendant_start(struct attendant__process *process, const char* path,
+  char const* argv[], int wait)
+{
+  return attendant_start_sealed(process, path, argv, wait, NULL, 0);
+}
+
+/* Copy a blob into a region that no one can change, not even us, so that the
+ * plugin server process can trust it without checking. On Linux that is a
+ * `memfd` with every seal. Elsewhere, the best we can do is a file descriptor
+ * opened read only on an unlinked temporary file. Returns the file
+ * descriptor, or -1. */
+static int seal(struct attendant__process *process, const void *blob,
+  size_t length)
+{
+  size_t offset;
+  int fd, writer, err;
+#ifdef __linux__
+  writer = fd = memfd_create("attendant", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+  char temporary[] = "/tmp/attendant.XXXXXX";
+  writer = mkstemp(temporary);
+  fd = -1;
+  if (writer != -1) {
+    fd = open(temporary, O_RDONLY);
+    unlink(temporary);
+  }
+#endif
+  if (writer == -1) {
+    return -1;
+  }
+  for (offset = 0, err = 0; offset < length && err != -1; offset += err) {
+    HANDLE_EINTR(write(writer, (const char *) blob + offset, length - offset),
+      err);
+  }
+#ifdef __linux__
+  if (err != -1) {
+    err = fcntl(fd, F_ADD_SEALS,
+      F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+  }
+#else
+  close(writer);
+#endif
+  if (err == -1 || fd == -1) {
+    if (fd != -1) {
+      close(fd);
+    }
+    return -1;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  return sidestep(process, fd);
+}
+
+/* &mdash; */
+int attendant_start_sealed(struct attendant__process *process,
+  const char* path, char const* argv[], int wait, const void *blob,
+  size_t length)
 {
-  int err, argc, i, running, shuttingdown = 0;
+  int err, argc, i, running, shuttingdown = 0, fd = -1;
   size_t size;
 
+  /* There is nothing to start without a successful initialization. */
+  FAIL(! process->initialized, START_NOT_INITIALIZED, fail);
+
   /* If we've been asked to wait, let's wait. We might get woken up by a
    * call to shutdown, but the path forward now is to launch the process server,
    * so we continue with startup, expecting that we'll shutdown the moment we
    * startup. */
-  if (wait) {
-    pthread_mutex_lock(&process.mutex);
-    say("[start/chilling] %d", wait);
-    pthread_cond_waitforabit(&process.cond.chilling, &process.mutex, wait);
-    shuttingdown = process.shuttingdown;
-    pthread_mutex_unlock(&process.mutex);
+  /* The crash loop policy may have already set a later time to start than the
+   * starter asks for. We take the later of the two. We wait out the full time
+   * in spite of spurious wake ups, unless we are woken by a shutdown. When the
+   * wait is over, so is any open circuit. */
+  pthread_mutex_lock(&process->mutex);
+  if (wait && monotonic() + wait > process->chilled) {
+    process->chilled = monotonic() + wait;
+  }
+  if (process->chilled) {
+    say("[start/chilling] %d", (int) (process->chilled - monotonic()));
+    while (! process->shuttingdown
+        && pthread_cond_waituntil(&process->cond.chilling, &process->mutex,
+          process->chilled));
+    process->chilled = 0;
   }
+  if (process->tripped) {
+    process->tripped = 0;
+    notify(process);
+  }
+  shuttingdown = process->shuttingdown;
+  pthread_mutex_unlock(&process->mutex);
 
   FAIL(shuttingdown, START_SHUTTING_DOWN, fail);
 
@@ -664,53 +1418,72 @@ static int start(const char* path, char const* argv[], int wait)
    * process is already running. You're not calling the addendant functions in
    * the correct order.
    */
-  pthread_mutex_lock(&process.mutex);
-  running = process.running;
-  pthread_mutex_unlock(&process.mutex);
+  pthread_mutex_lock(&process->mutex);
+  running = process->running;
+  pthread_mutex_unlock(&process->mutex);
 
   FAIL(running, START_ALREADY_RUNNING, fail);
 
+  /* Seal a new blob before we change anything, so that a mistake leaves the
+   * plugin attendant as it was. It is passed after the listener and the warm
+   * state, so the canary must not be there. */
+  if (blob != NULL) {
+    FAIL(process->canary == 3 + process->placed, START_CANARY_IS_BLOB_FD, fail);
+    fd = seal(process, blob, length);
+    FAIL(fd == -1, START_CANNOT_SEAL_BLOB, fail);
+  }
+
   /* Reset our error codes and increment the instance count. */
-  pthread_mutex_lock(&process.mutex);
-  process.errors.attendant = 0;
-  process.errors.system = 0;
-  process.instance++;
-  pthread_mutex_unlock(&process.mutex);
+  pthread_mutex_lock(&process->mutex);
+  process->errors.attendant = 0;
+  process->errors.system = 0;
+  process->instance++;
+  pthread_mutex_unlock(&process->mutex);
 
   /* Close any pipes that might still be open. */
-  close_pipes();
+  close_pipes(process);
+
+  /* Replace the last blob with the new one. The plugin server process is not
+   * running, so no launcher thread is reading the old one. */
+  if (fd != -1) {
+    if (process->blob != -1) {
+      close(process->blob);
+    }
+    process->blob = fd;
+    fd = -1;
+  }
 
   /* Count the number of arguments to the plugin server program. */
   for (argc = 0; argv[argc]; argc++);
 
   /* Create an array to store the arguments passed to the relay program. */
   size = sizeof(char *) * (argc + 5);
-  process.argv = malloc(size);
-  FAIL(!process.argv, START_CANNOT_MALLOC, fail);
-  memset(process.argv, 0, size);
+  process->argv = malloc(size);
+  FAIL(!process->argv, START_CANNOT_MALLOC, fail);
+  memset(process->argv, 0, size);
 
   /* The arguments to the relay program are name of the plugin process program
    * and the plugin process program arguments. We copy those values into the
    * null terminated arguments array. The first argument is the file descriptor
    * number for the status pipe, which we've not yet created, so leave that
    * `NULL`. */
-  process.argv[0] = strdup(process.relay);
-  process.argv[1] = NULL;
-  process.argv[2] = malloc(32);
-  FAIL(process.argv[2] == NULL, START_CANNOT_MALLOC, fail);
-  sprintf(process.argv[2], "%d", process.canary);
+  process->argv[0] = strdup(process->relay);
+  process->argv[1] = NULL;
+  process->argv[2] = malloc(32);
+  FAIL(process->argv[2] == NULL, START_CANNOT_MALLOC, fail);
+  sprintf(process->argv[2], "%d", process->canary);
 
-  process.argv[3] = strdup(path);
+  process->argv[3] = strdup(path);
   for (i = 0; i < argc; i++) {
-    process.argv[i + 4] = strdup(argv[i]);
-    FAIL(process.argv[i + 4] == NULL, START_CANNOT_MALLOC, fail);
+    process->argv[i + 4] = strdup(argv[i]);
+    FAIL(process->argv[i + 4] == NULL, START_CANNOT_MALLOC, fail);
   }
-  process.argv[argc + 4] = NULL;
+  process->argv[argc + 4] = NULL;
 
-  process.start_time = time(NULL);
+  process->start_time = time(NULL);
 
   /* Create a launcher thread. */
-  err = pthread_create(&process.launcher, NULL, launch, NULL);
+  err = pthread_create(&process->launcher, NULL, launch, process);
   FAIL(err != 0, START_CANNOT_SPAWN_THREAD, fail);
 
   say("[start/success]");
@@ -719,7 +1492,10 @@ static int start(const char* path, char const* argv[], int wait)
   /* Do we signal_termination here? No. Nothing has happened here that we could
    * ever hope to recover from. */
 fail:
-  free_argv();
+  if (fd != -1) {
+    close(fd);
+  }
+  free_argv(process);
   return -1;
 }
 
@@ -730,13 +1506,13 @@ fail:
  * pipe, assigning it the file descriptor of the previous plugin stub file
  * descriptor. We then close the temporary plugin stub end file descriptor and
  * record the plugin server process end in our static process structure. */
-static int recycle(int pipeno, int parent) {
+static int recycle(struct attendant__process *process, int pipeno, int parent) {
   int temp[2], child = parent ^ 1, err;
   err = pipe(temp);
   FAIL(err == -1, LAUNCH_CANNOT_CREATE_STDIN_PIPE + pipeno, fail);
-  HANDLE_EINTR(dup2(temp[parent], process.pipes[pipeno][parent]), err);
+  HANDLE_EINTR(dup2(temp[parent], process->pipes[pipeno][parent]), err);
   HANDLE_EINTR(close(temp[parent]), err);
-  process.pipes[pipeno][child] = temp[child];
+  process->pipes[pipeno][child] = temp[child];
 fail:
   return err; 
 }
@@ -745,9 +1521,10 @@ fail:
  * This function is called once for each stdio pipe.  It is called after fork
  * and prior to the exec of the relay program. Only can only make async-safe
  * system calls. Errors are reported through the status pipe. */
-static void duplicate(int spipe, int pipeno, int end, int fd) {
+static void duplicate(struct attendant__process *process, int spipe, int pipeno,
+    int end, int fd) {
   int err; 
-  HANDLE_EINTR(dup2(process.pipes[pipeno][end], fd), err);
+  HANDLE_EINTR(dup2(process->pipes[pipeno][end], fd), err);
   if (err == -1) {
     send_error(spipe, START_CANNOT_DUP_STDIN_PIPE + pipeno);
   }
@@ -767,6 +1544,77 @@ static void duplicate(int spipe, int pipeno, int end, int fd) {
  * these, let me know your platform.
  */
 
+/* In shared mode, connect to the shared plugin server process, if it is
+ * listening. The socket takes the place of the plugin stub end of the canary
+ * pipe, hanging up when the plugin server process exits or closes the
+ * connection. Returns true if we are attached. */
+static int attach(struct attendant__process *process) {
+  struct sockaddr_un address;
+  int fd, err;
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) {
+    return 0;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, process->rendezvous);
+
+  HANDLE_EINTR(connect(fd, (struct sockaddr *) &address, sizeof(address)), err);
+  if (err == -1) {
+    close(fd);
+    return 0;
+  }
+
+  process->pid = 0;
+  process->pipes[PIPE_CANARY][0] = fd;
+
+  return 1;
+}
+
+/* Append the file descriptors we pass to the second argument to the relay
+ * program, after the canary, each with its name, then the registry socket.
+ * We build it at launch, after the previous reaper thread has taken the last
+ * of the registrations. */
+static int bequeath(struct attendant__process *process) {
+  char *argument, *end;
+  int i;
+
+  argument = malloc(48 * (process->registered + 8));
+  if (argument == NULL) {
+    return -1;
+  }
+  end = argument + sprintf(argument, "%d", process->canary);
+  if (process->listener != -1) {
+    end += sprintf(end, ",%d:listener", process->listener);
+  }
+  if (process->warm != -1) {
+    end += sprintf(end, ",%d:warm", process->warm);
+  }
+  if (process->blob != -1) {
+    end += sprintf(end, ",%d:blob", process->blob);
+  }
+  for (i = 0; i < process->registered; i++) {
+    end += sprintf(end, ",%d:%s", process->registry[i].fd,
+      process->registry[i].name);
+  }
+  if (process->pipes[PIPE_REGISTRY][1] != -1) {
+    end += sprintf(end, ",ATTENDANT_REGISTRY@%d",
+      process->pipes[PIPE_REGISTRY][1]);
+  }
+  if (process->pipes[PIPE_CONTROL][1] != -1) {
+    end += sprintf(end, ",ATTENDANT_CONTROL@%d,ATTENDANT_HEARTBEAT@%d",
+      process->pipes[PIPE_CONTROL][1], process->page);
+  }
+
+  free(process->argv[2]);
+  process->argv[2] = argument;
+
+  return 0;
+}
+
 /* Encapsulates a test for an error condition that will never happen. */
 #define PARTIAL_READ(actual, expected, code, label) \
   FAIL(actual != expected, PARTIAL_ ## code, label)
@@ -779,53 +1627,100 @@ static void duplicate(int spipe, int pipeno, int end, int fd) {
 /* &#9824; */
 static void *launch(void *data)
 {
+  struct attendant__process *process = data;
   int status, confirm, spipe, err, i, code[2];
+  attendant__pipe_t in, out;
 
   /* Join the reaper thread. We do not need the result. */
-  pthread_join(process.reaper, NULL);
+  pthread_join(process->reaper, NULL);
+
+  /* If a shared plugin server process is listening, there is nothing to
+   * launch. Otherwise we launch one ourselves. */
+  process->attached = process->rendezvous != NULL && attach(process);
+  if (process->attached) {
+    say("[launch/attached]");
+    goto connect;
+  }
 
   /* Create new pipes for stdio that reuse the file descriptor of the plugin
    * stub side of the previous stdio pipes. The pipe file descriptors stay the
    * same for the life cycle of the plugin, saving us some thread
    * sychnornization headaches. */
-  recycle(PIPE_STDIN, 1);
-  recycle(PIPE_STDOUT, 0);
-  recycle(PIPE_STDERR, 0);
+  recycle(process, PIPE_STDIN, 1);
+  recycle(process, PIPE_STDOUT, 0);
+  recycle(process, PIPE_STDERR, 0);
 
   /* Create the remaning four pipes. The details of the pipes can be found in
    * the annotations above under the heading **Pipes**.
    */
   for (i = PIPE_FORK; i <= PIPE_CANARY; i++) {
-    err = pipe(process.pipes[i]);
+    err = pipe(process->pipes[i]);
     FAIL(err == -1, LAUNCH_CANNOT_CREATE_STDIN_PIPE + i, fail);
   }
 
   /* Except for STDIN, all the read ends of the pipes are close on exit. */
   for (i = PIPE_STDOUT; i <= PIPE_CANARY; i++) {
-    fcntl(process.pipes[i][0], F_SETFD, FD_CLOEXEC);
+    fcntl(process->pipes[i][0], F_SETFD, FD_CLOEXEC);
   }
 
   /* The write ends of the STDIN and FORK pipes are close on exit. */
-  fcntl(process.pipes[PIPE_STDIN][1], F_SETFD, FD_CLOEXEC);
-  fcntl(process.pipes[PIPE_FORK][1], F_SETFD, FD_CLOEXEC);
+  fcntl(process->pipes[PIPE_STDIN][1], F_SETFD, FD_CLOEXEC);
+  fcntl(process->pipes[PIPE_FORK][1], F_SETFD, FD_CLOEXEC);
+
+  /* Create the registry socket if the plugin server process can leave file
+   * descriptors to its successors. Both ends are close on exec, we will open
+   * the plugin server process end after fork. Ours is non-blocking, so that
+   * the reaper thread can take every registration waiting. */
+  if (process->inherit) {
+    err = socketpair(AF_UNIX, SOCK_DGRAM, 0, process->pipes[PIPE_REGISTRY]);
+    FAIL(err == -1, LAUNCH_CANNOT_CREATE_REGISTRY_SOCKET, fail);
+    for (i = 0; i < 2; i++) {
+      fcntl(process->pipes[PIPE_REGISTRY][i], F_SETFD, FD_CLOEXEC);
+    }
+    fcntl(process->pipes[PIPE_REGISTRY][0], F_SETFL,
+      fcntl(process->pipes[PIPE_REGISTRY][0], F_GETFL) | O_NONBLOCK);
+  }
+
+  /* Create the control socket if the plugin server process uses the companion
+   * library, and start its heartbeat from zero. Ours is non-blocking, and
+   * must not raise `SIGPIPE` should we write to a plugin server process that
+   * has exited. */
+  if (process->companion) {
+    err = socketpair(AF_UNIX, SOCK_STREAM, 0, process->pipes[PIPE_CONTROL]);
+    FAIL(err == -1, LAUNCH_CANNOT_CREATE_CONTROL_SOCKET, fail);
+    for (i = 0; i < 2; i++) {
+      fcntl(process->pipes[PIPE_CONTROL][i], F_SETFD, FD_CLOEXEC);
+    }
+    fcntl(process->pipes[PIPE_CONTROL][0], F_SETFL,
+      fcntl(process->pipes[PIPE_CONTROL][0], F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    i = 1;
+    setsockopt(process->pipes[PIPE_CONTROL][0], SOL_SOCKET, SO_NOSIGPIPE, &i,
+      sizeof(i));
+#endif
+    memset(process->heartbeat, 0, sizeof(struct attendant__heartbeat));
+  }
+
+  /* Pass the listener, the registered file descriptors and the channels. */
+  FAIL(bequeath(process) == -1, LAUNCH_CANNOT_MALLOC, fail);
 
   /* Make the first argument to relay the string value of the status pipe. */
-  spipe = process.pipes[PIPE_RELAY][1];
-  process.argv[1] = malloc(32);
-  FAIL(process.argv[1] == NULL, LAUNCH_CANNOT_MALLOC, fail);
-  sprintf(process.argv[1], "%d", spipe);
+  spipe = process->pipes[PIPE_RELAY][1];
+  process->argv[1] = malloc(32);
+  FAIL(process->argv[1] == NULL, LAUNCH_CANNOT_MALLOC, fail);
+  sprintf(process->argv[1], "%d", spipe);
 
-  for (i = 0; process.argv[i]; i++) {
-    say("argv[%d] = %s", i, process.argv[i]);
+  for (i = 0; process->argv[i]; i++) {
+    say("argv[%d] = %s", i, process->argv[i]);
   }
 
   say("[launch/fork]");
 
   /* Let us fork.*/
-  process.pid = fork();
+  process->pid = fork();
 
   /* A zero pid means that we are the child process. */
-  if (process.pid == 0) {
+  if (process->pid == 0) {
     /* We are in a race to fork. There is little we can do here because our host
      * application might be a multi-threaded application. Many system calls and
      * standard library calls are off limits. We can't malloc, for example. We
@@ -833,17 +1728,55 @@ static void *launch(void *data)
      * reset of the cleanup. */
 
     /* Create a pipe for stdout.  */
-    duplicate(spipe, PIPE_STDIN, 0, STDIN_FILENO);
-    duplicate(spipe, PIPE_STDOUT, 1, STDOUT_FILENO);
-    //duplicate(spipe, PIPE_STDERR, 0, 1, STDERR_FILENO);
+    duplicate(process, spipe, PIPE_STDIN, 0, STDIN_FILENO);
+    duplicate(process, spipe, PIPE_STDOUT, 1, STDOUT_FILENO);
+
+    /* Standard error is left to the host application, unless we are to keep
+     * its tail or log it. */
+    if (process->tail.size || process->logbook.path) {
+      duplicate(process, spipe, PIPE_STDERR, 1, STDERR_FILENO);
+    }
 
     /* Duplicate the pulse pipe to the file descriptor specified at attendant
      * initialization.  dup2 will close the target file descriptor if it is
      * open. If the aribitrarily chosen fd assigned to the write end of the pipe
      * is by conicidence the canary file descriptor, dup2 does nothing. */
-    HANDLE_EINTR(dup2(process.pipes[PIPE_CANARY][1], process.canary), err);
+    HANDLE_EINTR(dup2(process->pipes[PIPE_CANARY][1], process->canary), err);
+
+    /* The listening socket, the warm state, the blob, the registered file
+     * descriptors and the channels to us are close on exec in the host
+     * application, but the relay program needs them. The relay program will
+     * move them into place. */
+    if (process->listener != -1) {
+      fcntl(process->listener, F_SETFD, 0);
+    }
+    if (process->warm != -1) {
+      fcntl(process->warm, F_SETFD, 0);
+    }
+    if (process->blob != -1) {
+      fcntl(process->blob, F_SETFD, 0);
+    }
+    for (i = 0; i < process->registered; i++) {
+      fcntl(process->registry[i].fd, F_SETFD, 0);
+    }
+    if (process->pipes[PIPE_REGISTRY][1] != -1) {
+      fcntl(process->pipes[PIPE_REGISTRY][1], F_SETFD, 0);
+    }
+    if (process->pipes[PIPE_CONTROL][1] != -1) {
+      fcntl(process->pipes[PIPE_CONTROL][1], F_SETFD, 0);
+      fcntl(process->page, F_SETFD, 0);
+    }
 
-    execv(process.relay, process.argv);
+    /* Affinity is inherited across exec, so we pin here, before the plugin
+     * server process can start any threads. A failure to pin is not worth a
+     * failure to start. */
+#ifdef __linux__
+    if (process->pinned) {
+      sched_setaffinity(0, sizeof(process->affinity), &process->affinity);
+    }
+#endif
+
+    execv(process->relay, process->argv);
 
     /* If we are here, we did not execv. If we execv, the program is replace
      * with the relay program so this code is not executed. If we are here, we
@@ -864,24 +1797,28 @@ static void *launch(void *data)
   /* We have failed to do so much as fork. Why does fork fail? Not enough
    * memory to copy the process, not enough memory in the kernel to allocate the
    * housekeeping, or there is resource limit on the number of processes. */
-  FAIL(process.pid == -1, LAUNCH_CANNOT_FORK, fail);
+  FAIL(process->pid == -1, LAUNCH_CANNOT_FORK, fail);
+
+  say("[launch/relay] %d", process->pid);
 
   /* Close the child end of all of the pipes we've just created. We do not close
    * the reaper pipe, of course, because it lasts for the life time of the
    * plugin attendant. */
-  close_pipe(PIPE_STDIN, 0);
-  close_pipe(PIPE_STDOUT, 1);
-  close_pipe(PIPE_STDERR, 1);
-  close_pipe(PIPE_FORK, 1);
-  close_pipe(PIPE_RELAY, 1);
-  close_pipe(PIPE_CANARY, 1);
+  close_pipe(process, PIPE_STDIN, 0);
+  close_pipe(process, PIPE_STDOUT, 1);
+  close_pipe(process, PIPE_STDERR, 1);
+  close_pipe(process, PIPE_FORK, 1);
+  close_pipe(process, PIPE_RELAY, 1);
+  close_pipe(process, PIPE_CANARY, 1);
+  close_pipe(process, PIPE_REGISTRY, 1);
+  close_pipe(process, PIPE_CONTROL, 1);
 
   /* Wait for the fork pipe to close. It will be a read that returns zero bytes.
    * We're only interested in a successful return. The buffer will be empty. */
-  HANDLE_EINTR(read(process.pipes[PIPE_FORK][0], &confirm, sizeof(confirm)), err);
+  HANDLE_EINTR(read(process->pipes[PIPE_FORK][0], &confirm, sizeof(confirm)), err);
   
   /* Close the file descriptor of the plugin stub end of the status pipe. */
-  close_pipe(PIPE_FORK, 0);
+  close_pipe(process, PIPE_FORK, 0);
 
   /* Many of the error checks below are assertions, not exception handlers.
    *
@@ -905,13 +1842,13 @@ static void *launch(void *data)
    */
 
   /* The relay will write the status pipe file descriptor to stdandard out. */
-  HANDLE_EINTR(read(process.pipes[PIPE_STDOUT][0], &confirm, sizeof(confirm)), err);
+  HANDLE_EINTR(read(process->pipes[PIPE_STDOUT][0], &confirm, sizeof(confirm)), err);
 
   /* If zero, the standard I/O pipe hung up, it means the relay did not execute
    * or exited immediately. */
   if (err == 0) {
     /* Read the error code. */
-    HANDLE_EINTR(read(process.pipes[PIPE_RELAY][0], code, sizeof(code)), err);
+    HANDLE_EINTR(read(process->pipes[PIPE_RELAY][0], code, sizeof(code)), err);
 
     /* Zero bytes returned means the relay program exited immediately because we
      * fed it a malformed status pipe file descriptor.  It won't write an error
@@ -923,8 +1860,8 @@ static void *launch(void *data)
     PARTIAL_READ(err, sizeof(code), FORK_ERROR_CODE, fail);
 
     /* Set the plugin attendant error code and system error number. */
-    process.errors.attendant = code[0];
-    process.errors.system = code[1];
+    process->errors.attendant = code[0];
+    process->errors.system = code[1];
 
     /* Abend. */
     goto fail;
@@ -936,8 +1873,10 @@ static void *launch(void *data)
     /* Assert that we passed the correct file descriptor through stdout. */
     FAIL(confirm != spipe, LAUNCH_RELAY_PIPE_STDOUT_FAILED, fail); 
 
+    say("[launch/handshake]");
+
     /* Read the status pipe file descriptor number from the status pipe itself. */
-    HANDLE_EINTR(read(process.pipes[PIPE_RELAY][0], &confirm, sizeof(confirm)), err);
+    HANDLE_EINTR(read(process->pipes[PIPE_RELAY][0], &confirm, sizeof(confirm)), err);
 
     /* Assert that the relay pipe is still open. */
     FAIL(err == 0, LAUNCH_RELAY_PIPE_HUNG_UP, fail); 
@@ -953,7 +1892,7 @@ static void *launch(void *data)
   say("[launch/forked]");
 
   /* Now know that our status pipe is setup correctly, read an error if any. */
-  HANDLE_EINTR(read(process.pipes[PIPE_RELAY][0], code, sizeof(code)), err);
+  HANDLE_EINTR(read(process->pipes[PIPE_RELAY][0], code, sizeof(code)), err);
 
   /* Zero means we hung, up. which is wonderful. Our plugin server process is up
    * and running. Otherwise, the relay program encoutered an error. */
@@ -962,24 +1901,37 @@ static void *launch(void *data)
     PARTIAL_READ(err, sizeof(code), EXEC_ERROR_CODE, fail);
 
     /* Set the plugin attendant error code and system error number. */
-    process.errors.attendant = code[0];
-    process.errors.system = code[1];
+    process->errors.attendant = code[0];
+    process->errors.system = code[1];
 
     /* Abend. */
     goto fail;
   }
 
   /* Call the application developer provided connector to initiate the plugin
-   * stub to plugin server process IPC. */
-  process.connector(process.pipes[PIPE_STDIN][1], process.pipes[PIPE_STDOUT][0]);
+   * stub to plugin server process IPC. When attached, the socket is the only
+   * channel there is. */
+connect:
+  say("[launch/connect]");
+  if (process->attached) {
+    in = out = process->pipes[PIPE_CANARY][0];
+  } else {
+    in = process->pipes[PIPE_STDIN][1];
+    out = process->pipes[PIPE_STDOUT][0];
+  }
+  if (process->connector_r) {
+    process->connector_r(process->context, in, out);
+  } else {
+    process->connector(in, out);
+  }
 
   /* Our server process is now up and running correctly. Time to launch the
    * reaper thread. This reaper thread monitor the plugin server process for
    * termination. */
-  pthread_create(&process.reaper, NULL, reap, NULL);
+  pthread_create(&process->reaper, NULL, reap, process);
 
   /* Don't need these anymore. */
-  free_argv();
+  free_argv(process);
 
   say("[launch/success]");
 
@@ -990,67 +1942,874 @@ fail:
 
   say("[launch/failure]");
 
-  if (process.pid > 0) {
+  if (process->pid > 0) {
     /* There is no logic in the relay that doesn't exit immediately. If it is
      * hung and a `SIGKILL` is necessary, then plugin attendant is broken. */
-    kill(process.pid, SIGKILL);
+    kill(process->pid, SIGKILL);
 
     /* Reap the process. If the host application is set to ignore `SIGCHLD` then
      * we skip this step. */
-    if (process.waitable) {
-      HANDLE_EINTR(waitpid(process.pid, &status, 0), err);
+    if (process->waitable) {
+      HANDLE_EINTR(waitpid(process->pid, &status, 0), err);
     }
   }
 
   /* Close the pipes we created. */
-  close_pipes();
+  close_pipes(process);
 
   /* Release the arguments. */
-  free_argv();
+  free_argv(process);
 
   /* We go into our abend procedure. */
-  signal_termination();
+  signal_termination(process);
 
   return NULL;
 }
 
-/* ### Reaper */
-
-/* The reaper thread waits for the plugin server process to exit by polling to
- * the canary pipe for hang up. We do this because we cannot count on `waitpid`.
- * 
- * There are two ways in which the exit status from the server process may be
- * intercepted. First, we might not be able to use `waitpid` at all, because the
- * host program set `SIGCHLD` to `SIG_IGN`. Second, if `SIGCHLD` is waitable,
- * the host application might be doing a blanket wait, and it might reap the
- * child process, obtaining the pid, leaving us with an `ECHILD` error. Thus, we
- * don't bother saving the exit code.
+/* ### Endpoint
+ *
+ * The reaper thread carries frames between the stable endpoint and the plugin
+ * server process. It must never block on either, so it only reads what it has
+ * room for and only writes what there is room for, and keeps the rest here.
  */
 
-/* &#9824; */
-static void* reap(void *data)
-{
-  static int REAPER = 0, CANARY = 1;
-  int input[2], instance = 0,
-    sig = SIGTERM, timeout = -1, hangup = 0, shutdown = 0;
-  int status, err, fds[2], i, j, count;
-  struct pollfd channels[4];
-  char buffer[2048];
+/* Append bytes to a buffer, growing it if needed. Returns -1 if we cannot. */
+static int append(struct buffer *buffer, const void *data, size_t length) {
+  size_t size = buffer->size ? buffer->size : 4096;
+  char *grown;
+  if (buffer->length + length > buffer->size) {
+    while (size < buffer->length + length) {
+      size *= 2;
+    }
+    grown = realloc(buffer->data, size);
+    if (grown == NULL) {
+      return -1;
+    }
+    buffer->data = grown;
+    buffer->size = size;
+  }
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+  return 0;
+}
 
-  say("[reaper/start]");
+/* Remove bytes from the front of a buffer. */
+static void consume(struct buffer *buffer, size_t length) {
+  memmove(buffer->data, buffer->data + length, buffer->length - length);
+  buffer->length -= length;
+}
 
-  fds[0] = process.pipes[PIPE_STDOUT][0];
-  fds[1] = process.pipes[PIPE_STDERR][0];
+/* Returns the length of the frame at the front of the buffer, header and all,
+ * or zero if it is not all there yet. */
+static size_t framed(struct buffer *buffer, struct attendant__frame *header) {
+  if (buffer->length < sizeof(*header)) {
+    return 0;
+  }
+  memcpy(header, buffer->data, sizeof(*header));
+  if (buffer->length - sizeof(*header) < header->length) {
+    return 0;
+  }
+  return sizeof(*header) + header->length;
+}
 
-  /* Join the reaper launcher. We do not need the result. */
-  pthread_join(process.launcher, NULL);
+/* Forget the request at the given index. */
+static void forget(struct journal *journal, int i) {
+  free(journal->entries[i].frame);
+  memmove(&journal->entries[i], &journal->entries[i + 1],
+    (journal->count - i - 1) * sizeof(struct entry));
+  journal->count--;
+  if (i < journal->sent) {
+    journal->sent--;
+  }
+}
 
-  /* Tell the library stub functions that we are running. */
-  (void) pthread_mutex_lock(&process.mutex);
-  process.running = 1;
-  process.restarting = 0;
-  (void) pthread_cond_signal(&process.cond.running);
-  (void) pthread_mutex_unlock(&process.mutex);
+/* Write what we can of the replies we owe the plugin stub. */
+static void deliver(struct attendant__process *process, int stub) {
+  struct journal *journal = &process->journal;
+  int err;
+  if (stub != -1 && journal->outbound.length) {
+    HANDLE_EINTR(write(stub, journal->outbound.data, journal->outbound.length),
+      err);
+    if (err > 0) {
+      consume(&journal->outbound, err);
+    }
+  }
+}
+
+/* Set the poll events for the endpoint and the plugin server process. We read
+ * requests while we have room to remember them, and replies while we do not
+ * have too many waiting on the plugin stub. */
+static void courier_events(struct attendant__process *process,
+    struct pollfd *channels, int stub, int in, int out) {
+  struct journal *journal = &process->journal;
+
+  channels[0].fd = stub;
+  channels[0].events = (journal->count < journal->capacity ? POLLIN : 0)
+                     | (journal->outbound.length ? POLLOUT : 0);
+  channels[1].fd = in;
+  channels[1].events = journal->sent < journal->count ? POLLOUT : 0;
+  channels[2].fd = out;
+  channels[2].events = journal->outbound.length < 65536 ? POLLIN : 0;
+  channels[0].revents = channels[1].revents = channels[2].revents = 0;
+}
+
+/* Carry requests from the endpoint to the plugin server process and replies
+ * back. A file descriptor that hangs up is set to -1, so that we stop polling
+ * it. It is the canary that tells us the plugin server process has exited. */
+
+/* &#9824; */
+static void courier(struct attendant__process *process,
+    struct pollfd *channels, int *stub, int *in, int *out) {
+  struct journal *journal = &process->journal;
+  struct attendant__frame header;
+  struct entry *entry;
+  char buffer[4096];
+  size_t length;
+  int err, i;
+
+  /* Read requests from the plugin stub. */
+  if (channels[0].revents & POLLIN) {
+    HANDLE_EINTR(read(*stub, buffer, sizeof(buffer)), err);
+    if (err > 0) {
+      FAIL(append(&journal->requests, buffer, err) == -1,
+        REAPER_CANNOT_MALLOC, fail);
+    } else if (err == 0 || errno != EAGAIN) {
+      *stub = -1;
+    }
+  } else if (channels[0].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+    *stub = -1;
+  }
+
+  /* Remember every request we have room for. */
+  while (journal->count < journal->capacity
+      && (length = framed(&journal->requests, &header)) != 0) {
+    entry = &journal->entries[journal->count];
+    entry->frame = malloc(length);
+    FAIL(entry->frame == NULL, REAPER_CANNOT_MALLOC, fail);
+    memcpy(entry->frame, journal->requests.data, length);
+    entry->length = length;
+    entry->id = header.id;
+    entry->flags = header.flags;
+    journal->count++;
+    consume(&journal->requests, length);
+  }
+
+  /* Send what we can to the plugin server process. */
+  while (*in != -1 && journal->sent < journal->count) {
+    entry = &journal->entries[journal->sent];
+    HANDLE_EINTR(write(*in, entry->frame + journal->offset,
+      entry->length - journal->offset), err);
+    if (err == -1) {
+      if (errno != EAGAIN) {
+        *in = -1;
+      }
+      break;
+    }
+    journal->offset += err;
+    if (journal->offset == entry->length) {
+      journal->sent++;
+      journal->offset = 0;
+    }
+  }
+  if (channels[1].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+    *in = -1;
+  }
+
+  /* Read replies from the plugin server process. */
+  if (channels[2].revents & POLLIN) {
+    HANDLE_EINTR(read(*out, buffer, sizeof(buffer)), err);
+    if (err > 0) {
+      FAIL(append(&journal->replies, buffer, err) == -1,
+        REAPER_CANNOT_MALLOC, fail);
+    } else if (err == 0 || errno != EAGAIN) {
+      *out = -1;
+    }
+  } else if (channels[2].revents & (POLLHUP | POLLERR | POLLNVAL)) {
+    *out = -1;
+  }
+
+  /* A reply means we can forget the request. */
+  while ((length = framed(&journal->replies, &header)) != 0) {
+    for (i = 0; i < journal->sent; i++) {
+      if (journal->entries[i].id == header.id) {
+        forget(journal, i);
+        break;
+      }
+    }
+    FAIL(append(&journal->outbound, journal->replies.data, length) == -1,
+      REAPER_CANNOT_MALLOC, fail);
+    consume(&journal->replies, length);
+  }
+
+fail:
+  deliver(process, *stub);
+}
+
+/* When the plugin server process has exited, we answer the requests it was
+ * sent that we cannot replay, and start over with the next one. When we are
+ * shutting down, there is no next one, so we answer them all, and give the
+ * plugin stub a moment to read the answers. */
+
+/* &#9824; */
+static void strand(struct attendant__process *process) {
+  struct journal *journal = &process->journal;
+  struct attendant__frame header;
+  struct pollfd pollfd;
+  int sent, shuttingdown, i, err;
+
+  (void) pthread_mutex_lock(&process->mutex);
+  shuttingdown = process->shuttingdown;
+  (void) pthread_mutex_unlock(&process->mutex);
+
+  sent = journal->sent + (journal->offset != 0);
+  for (i = 0; i < journal->count;) {
+    if (shuttingdown || (i < sent
+        && ! (journal->entries[i].flags & ATTENDANT_FRAME_IDEMPOTENT))) {
+      header.length = 0;
+      header.id = journal->entries[i].id;
+      header.flags = ATTENDANT_FRAME_LOST;
+      if (append(&journal->outbound, &header, sizeof(header)) == -1) {
+        set_error(process, REAPER_CANNOT_MALLOC);
+      }
+      forget(journal, i);
+      if (i < sent) {
+        sent--;
+      }
+    } else {
+      i++;
+    }
+  }
+  journal->sent = 0;
+  journal->offset = 0;
+  journal->replies.length = 0;
+
+  pollfd.fd = process->endpoint[1];
+  pollfd.events = POLLOUT;
+  while (journal->outbound.length) {
+    pollfd.revents = 0;
+    HANDLE_EINTR(poll(&pollfd, 1, shuttingdown ? 1000 : 0), err);
+    if (err != 1 || (pollfd.revents & POLLOUT) == 0) {
+      break;
+    }
+    deliver(process, process->endpoint[1]);
+  }
+}
+
+/* ### Registry */
+
+/* The plugin server process registers a file descriptor for its successors by
+ * sending its name on the registry socket with the file descriptor attached. A
+ * name already registered is replaced, and a name sent alone is forgotten. We
+ * keep a duplicate of each file descriptor, so that it outlives the plugin
+ * server process that registered it.
+ *
+ * A registration that we cannot read or do not understand is ignored. The
+ * plugin server process has no way to hear our complaint, and an error would
+ * bring down the plugin attendant for the sake of an optimization.
+ */
+
+/* &#9824; */
+static int receive(struct attendant__process *process) {
+  char name[HEIRLOOM_NAME], control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov;
+  struct msghdr message;
+  struct cmsghdr *cmsg;
+  int err, fd = -1, flags = 0, i, j;
+
+#ifdef MSG_CMSG_CLOEXEC
+  flags = MSG_CMSG_CLOEXEC;
+#endif
+
+  memset(&message, 0, sizeof(message));
+  iov.iov_base = name;
+  iov.iov_len = sizeof(name) - 1;
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+
+  HANDLE_EINTR(recvmsg(process->pipes[PIPE_REGISTRY][0], &message, flags), err);
+  if (err == -1) {
+    return 0;
+  }
+
+  /* Take the file descriptor, if any, before we decide against it, so that we
+   * do not leak it. It must not be left open in the next plugin server process
+   * unless we pass it, nor land on the canary. */
+  for (cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+      fd = sidestep(process, fd);
+    }
+  }
+
+  /* Names are short and plain, so that they can be passed as arguments and
+   * joined with colons. */
+  name[err] = '\0';
+  if (err == 0 || (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+      || strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+      "0123456789._-") != err) {
+    say("[registry/rejected]");
+    if (fd != -1) {
+      close(fd);
+    }
+    return 1;
+  }
+
+  for (i = 0; i < process->registered; i++) {
+    if (strcmp(process->registry[i].name, name) == 0) {
+      break;
+    }
+  }
+
+  /* Forget or replace a registered file descriptor. */
+  if (i < process->registered) {
+    close(process->registry[i].fd);
+    if (fd == -1) {
+      say("[registry/forget] %s", name);
+      process->registered--;
+      for (j = i; j < process->registered; j++) {
+        process->registry[j] = process->registry[j + 1];
+      }
+    } else {
+      say("[registry/replace] %s", name);
+      process->registry[i].fd = fd;
+    }
+  /* Or register a new one if there is room. */
+  } else if (fd != -1) {
+    if (process->registered < process->inherit) {
+      say("[registry/register] %s", name);
+      process->registry[i].fd = fd;
+      strcpy(process->registry[i].name, name);
+      process->registered++;
+    } else {
+      say("[registry/full] %s", name);
+      close(fd);
+    }
+  }
+
+  return 1;
+}
+
+/* ### Sampler */
+
+/* The reaper thread samples the plugin server process from `/proc`. We read
+ * the files whole and pick out the fields we want. A field that is not there
+ * is zero. A plugin server process that has exited between the poll and the
+ * read has no files, and we take no sample. */
+
+/* Read a small file into the buffer. Returns the bytes read or -1. */
+static int slurp(const char *path, char *buffer, int size) {
+  int fd, err, length = 0;
+
+  HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC), fd);
+  if (fd == -1) {
+    return -1;
+  }
+  do {
+    HANDLE_EINTR(read(fd, buffer + length, size - 1 - length), err);
+    if (err > 0) {
+      length += err;
+    }
+  } while (err > 0 && length < size - 1);
+  close(fd);
+  buffer[length] = '\0';
+
+  return length;
+}
+
+/* Find a field in a file of `Name: value` lines. */
+static long long field(const char *buffer, const char *name) {
+  const char *found = strstr(buffer, name);
+  return found ? strtoll(found + strlen(name), NULL, 10) : 0;
+}
+
+/* Find the ten second average of a line of `/proc/pressure`. */
+static double level(const char *buffer, const char *name) {
+  const char *found = strstr(buffer, name);
+  double average = 0;
+  if (found) {
+    sscanf(found + strlen(name), " avg10=%lf", &average);
+  }
+  return average;
+}
+
+/* Take a sample, using the last for the CPU percentage. Returns 0, or -1 if the
+ * plugin server process cannot be sampled. */
+static int take_sample(struct attendant__process *process,
+  struct attendant__sample *sample, struct attendant__sample *last)
+{
+  char path[64], buffer[4096], *end;
+  unsigned long long utime, stime;
+  long rss, threads, ticks = sysconf(_SC_CLK_TCK);
+
+  memset(sample, 0, sizeof(*sample));
+  sample->pid = process->pid;
+  sample->taken = monotonic();
+
+  /* The name of the program is in parenthesis and may contain anything, so we
+   * parse what follows the last closing parenthesis. */
+  sprintf(path, "/proc/%d/stat", (int) process->pid);
+  if (slurp(path, buffer, sizeof(buffer)) == -1
+      || (end = strrchr(buffer, ')')) == NULL
+      || sscanf(end + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu "
+        "%llu %*d %*d %*d %*d %ld %*d %*u %*u %ld", &utime, &stime, &threads,
+        &rss) != 4) {
+    return -1;
+  }
+  sample->cpu_time = (utime + stime) * 1000 / ticks;
+  sample->threads = threads;
+  sample->rss = (long long) rss * sysconf(_SC_PAGESIZE);
+
+  sprintf(path, "/proc/%d/status", (int) process->pid);
+  if (slurp(path, buffer, sizeof(buffer)) != -1) {
+    sample->peak = field(buffer, "VmHWM:") * 1024;
+    sample->swap = field(buffer, "VmSwap:") * 1024;
+  }
+
+  sprintf(path, "/proc/%d/io", (int) process->pid);
+  if (slurp(path, buffer, sizeof(buffer)) != -1) {
+    sample->read_bytes = field(buffer, "\nread_bytes:");
+    sample->write_bytes = field(buffer, "\nwrite_bytes:");
+  }
+
+  if (last->pid == sample->pid && sample->taken > last->taken) {
+    sample->cpu = (int) ((sample->cpu_time - last->cpu_time) * 100
+      / (sample->taken - last->taken));
+  }
+
+  return 0;
+}
+
+/* Tell the library stub functions that we are running. Any number of plugin
+ * stub threads may be parked in `ready`, so we broadcast. */
+static void enter_service(struct attendant__process *process) {
+  (void) pthread_mutex_lock(&process->mutex);
+  process->running = 1;
+  process->active = monotonic();
+  (void) pthread_cond_broadcast(&process->cond.running);
+  notify(process);
+  (void) pthread_mutex_unlock(&process->mutex);
+}
+
+/* Count a pressure stall trigger that has fired. */
+static void stressed(struct attendant__process *process, int trigger) {
+  (void) pthread_mutex_lock(&process->mutex);
+  switch (trigger) {
+  case 0:
+    process->stress.some_fired++;
+    break;
+  case 1:
+    process->stress.full_fired++;
+    break;
+  default:
+    process->stress.cpu_fired++;
+    break;
+  }
+  process->stress.fired = monotonic();
+  process->stress.last = 1 << trigger;
+  (void) pthread_mutex_unlock(&process->mutex);
+}
+
+/* Keep the last of what the plugin server process wrote to standard error, in
+ * a ring. */
+static void remember(struct attendant__process *process, const char *data,
+    int length) {
+  size_t at, chunk;
+
+  if (process->tail.size == 0) {
+    return;
+  }
+
+  (void) pthread_mutex_lock(&process->mutex);
+  while (length > 0) {
+    at = process->tail.length % process->tail.size;
+    chunk = process->tail.size - at;
+    chunk = chunk < (size_t) length ? chunk : (size_t) length;
+    memcpy(process->tail.data + at, data, chunk);
+    process->tail.length += chunk;
+    data += chunk;
+    length -= chunk;
+  }
+  (void) pthread_mutex_unlock(&process->mutex);
+}
+
+/* ### Logging */
+
+/* &mdash; */
+static int open_log(struct attendant__process *process) {
+  struct logbook *log = &process->logbook;
+  int fd;
+
+  HANDLE_EINTR(open(log->path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644), fd);
+  log->fd = sidestep(process, fd);
+  if (log->fd == -1) {
+    return -1;
+  }
+  log->written = lseek(log->fd, 0, SEEK_END);
+
+  return log->written == -1 ? -1 : 0;
+}
+
+/* Rename the full log and those rotated before it, dropping the oldest, and
+ * start a new one. If we cannot, we stop logging. */
+static void rotate(struct attendant__process *process) {
+  struct logbook *log = &process->logbook;
+  size_t length = strlen(log->path) + 16;
+  char *from = malloc(length), *to = malloc(length);
+  int i;
+
+  close(log->fd);
+  log->fd = -1;
+
+  if (from != NULL && to != NULL) {
+    for (i = log->keep; i > 0; i--) {
+      if (i == 1) {
+        strcpy(from, log->path);
+      } else {
+        snprintf(from, length, "%s.%d", log->path, i - 1);
+      }
+      snprintf(to, length, "%s.%d", log->path, i);
+      rename(from, to);
+    }
+    if (log->keep <= 0) {
+      unlink(log->path);
+    }
+    if (open_log(process) == -1 && log->fd != -1) {
+      close(log->fd);
+      log->fd = -1;
+    }
+  }
+
+  free(from);
+  free(to);
+}
+
+/* Start a new second if this one is over, noting what we dropped in the last,
+ * and rotate the log if it is full. Returns how many of the bytes we want to
+ * write we may write now, zero if we are to drop them. */
+static size_t allowance(struct attendant__process *process, size_t want) {
+  struct logbook *log = &process->logbook;
+  long long now = monotonic();
+  char note[64];
+  int err;
+
+  if (log->second == 0 || now - log->second >= 1000) {
+    log->second = now;
+    log->spent = 0;
+    if (log->dropped && log->fd != -1) {
+      err = snprintf(note, sizeof(note), "attendant: dropped %lld bytes\n",
+        log->dropped);
+      HANDLE_EINTR(pwrite(log->fd, note, err, log->written), err);
+      log->written += err > 0 ? err : 0;
+    }
+    log->dropped = 0;
+  }
+
+  if (log->size && log->written >= log->size && log->fd != -1) {
+    rotate(process);
+  }
+
+  if (log->fd == -1) {
+    return 0;
+  }
+  if (log->rate) {
+    if (log->spent >= log->rate) {
+      return 0;
+    }
+    if ((long long) want > log->rate - log->spent) {
+      want = (size_t) (log->rate - log->spent);
+    }
+  }
+  if (log->size && (long long) want > log->size - log->written) {
+    want = (size_t) (log->size - log->written);
+  }
+
+  return want;
+}
+
+/* Write bytes we have read to the log. */
+static void scribble(struct attendant__process *process, const char *data,
+    size_t length) {
+  struct logbook *log = &process->logbook;
+  size_t allowed;
+  ssize_t err;
+
+  while (length > 0) {
+    allowed = allowance(process, length);
+    if (allowed == 0) {
+      break;
+    }
+    HANDLE_EINTR(pwrite(log->fd, data, allowed, log->written), err);
+    if (err <= 0) {
+      break;
+    }
+    log->written += err;
+    log->spent += err;
+    data += err;
+    length -= err;
+  }
+  log->dropped += length;
+}
+
+/* Move what is waiting in a pipe to the log. On Linux we splice it into the
+ * log file, or into `/dev/null` if we are over the rate, without copying. If
+ * the log file cannot be spliced into, we read and write. Returns what read
+ * would return. */
+static ssize_t record(struct attendant__process *process, int fd) {
+  struct logbook *log = &process->logbook;
+  char buffer[4096];
+  ssize_t moved;
+#ifdef __linux__
+  size_t allowed = allowance(process, 65536);
+  loff_t offset = log->written;
+
+  if (allowed == 0 && log->null != -1) {
+    HANDLE_EINTR(splice(fd, NULL, log->null, NULL, 65536, SPLICE_F_NONBLOCK),
+      moved);
+    if (moved > 0) {
+      log->dropped += moved;
+    }
+    if (moved != -1 || errno != EINVAL) {
+      return moved == -1 && errno == EAGAIN ? 0 : moved;
+    }
+  } else if (allowed != 0) {
+    HANDLE_EINTR(splice(fd, NULL, log->fd, &offset, allowed,
+      SPLICE_F_MOVE | SPLICE_F_NONBLOCK), moved);
+    if (moved > 0) {
+      log->written = offset;
+      log->spent += moved;
+    }
+    if (moved != -1 || errno != EINVAL) {
+      return moved == -1 && errno == EAGAIN ? 0 : moved;
+    }
+  }
+#endif
+
+  HANDLE_EINTR(read(fd, buffer, sizeof(buffer)), moved);
+  if (moved > 0) {
+    scribble(process, buffer, moved);
+  }
+
+  return moved;
+}
+
+/* Drain standard out or standard error, into the tail, the log, or nowhere.
+ * Returns what read would return. */
+static ssize_t drain(struct attendant__process *process, int fd, char *buffer,
+    size_t size) {
+  int error = fd == process->pipes[PIPE_STDERR][0];
+  ssize_t err;
+
+  if (error && process->tail.size) {
+    HANDLE_EINTR(read(fd, buffer, size), err);
+    if (err > 0) {
+      remember(process, buffer, err);
+      if (process->logbook.path) {
+        scribble(process, buffer, err);
+      }
+    }
+    return err;
+  }
+
+  if (process->logbook.path
+      && (error || process->stdio == ATTENDANT_STDIO_LOG)) {
+    return record(process, fd);
+  }
+
+  HANDLE_EINTR(read(fd, buffer, size), err);
+  return err;
+}
+
+/* Note what we dropped, when a plugin server process exits, rather than when
+ * the next second starts, which may be a long time coming. */
+static void settle(struct attendant__process *process) {
+  struct logbook *log = &process->logbook;
+  if (log->path && log->dropped) {
+    log->second = 0;
+    allowance(process, 0);
+  }
+}
+
+/* ### Snapshot */
+
+/* Before we kill a plugin server process that would not exit, we write down
+ * what each of its threads is doing. We build the snapshot in a buffer of our
+ * own, so that we read `/proc` without the mutex, and copy it over the last
+ * one when we are done. If we cannot allocate the buffer, we take no snapshot,
+ * because the kill matters more. */
+
+/* Append what fits to the snapshot. */
+static void jot(struct buffer *snapshot, const char *format, ...) {
+  va_list ap;
+  size_t room = snapshot->size - snapshot->length;
+  int err;
+
+  if (room <= 1) {
+    return;
+  }
+  va_start(ap, format);
+  err = vsnprintf(snapshot->data + snapshot->length, room, format, ap);
+  va_end(ap);
+  if (err > 0) {
+    snapshot->length += (size_t) err < room ? (size_t) err : room - 1;
+  }
+}
+
+/* Write down the state, wait channel, system call and kernel stack of each
+ * thread of the plugin server process. */
+static void snap(struct attendant__process *process) {
+  struct buffer snapshot;
+  DIR *dir;
+  struct dirent *entry;
+  char path[64], buffer[4096], *name, *end, *line;
+  int pid = (int) process->pid, tid;
+
+  snapshot.size = process->snapshot.size;
+  if (snapshot.size == 0 || (snapshot.data = malloc(snapshot.size)) == NULL) {
+    return;
+  }
+  snapshot.length = 0;
+  snapshot.data[0] = '\0';
+
+  jot(&snapshot, "pid %d at %lld\n", pid, monotonic());
+
+  sprintf(path, "/proc/%d/task", pid);
+  if ((dir = opendir(path)) != NULL) {
+    while ((entry = readdir(dir)) != NULL) {
+      if ((tid = atoi(entry->d_name)) == 0) {
+        continue;
+      }
+
+      /* The name is in parenthesis and may contain anything, so the state is
+       * what follows the last closing parenthesis. */
+      sprintf(path, "/proc/%d/task/%d/stat", pid, tid);
+      if (slurp(path, buffer, sizeof(buffer)) == -1
+          || (name = strchr(buffer, '(')) == NULL
+          || (end = strrchr(buffer, ')')) == NULL || end[1] == '\0') {
+        continue;
+      }
+      *end = '\0';
+      jot(&snapshot, "thread %d (%s) %c\n", tid, name + 1, end[2]);
+
+      sprintf(path, "/proc/%d/task/%d/wchan", pid, tid);
+      if (slurp(path, buffer, sizeof(buffer)) > 0) {
+        jot(&snapshot, "  wchan %s\n", buffer);
+      }
+
+      sprintf(path, "/proc/%d/task/%d/syscall", pid, tid);
+      if (slurp(path, buffer, sizeof(buffer)) > 0) {
+        jot(&snapshot, "  syscall %s", buffer);
+      }
+
+      sprintf(path, "/proc/%d/task/%d/stack", pid, tid);
+      if (slurp(path, buffer, sizeof(buffer)) > 0) {
+        for (line = buffer; *line; line = end) {
+          end = line + strcspn(line, "\n");
+          if (*end) {
+            *end++ = '\0';
+          }
+          jot(&snapshot, "  %s\n", line);
+        }
+      }
+    }
+    closedir(dir);
+  }
+
+  (void) pthread_mutex_lock(&process->mutex);
+  memcpy(process->snapshot.data, snapshot.data, snapshot.length + 1);
+  process->snapshot.length = snapshot.length;
+  (void) pthread_mutex_unlock(&process->mutex);
+
+  free(snapshot.data);
+}
+
+/* ### Reaper */
+
+/* The reaper thread waits for the plugin server process to exit by polling to
+ * the canary pipe for hang up. We do this because we cannot count on `waitpid`.
+ * 
+ * There are two ways in which the exit status from the server process may be
+ * intercepted. First, we might not be able to use `waitpid` at all, because the
+ * host program set `SIGCHLD` to `SIG_IGN`. Second, if `SIGCHLD` is waitable,
+ * the host application might be doing a blanket wait, and it might reap the
+ * child process, obtaining the pid, leaving us with an `ECHILD` error. Thus, we
+ * don't bother saving the exit code.
+ */
+
+/* &#9824; */
+static void* reap(void *data)
+{
+  struct attendant__process *process = data;
+  static int REAPER = 0, CANARY = 1;
+  int input[2], instance = 0,
+    sig = SIGTERM, timeout = -1, hangup = 0, shutdown = 0;
+  long long grace = 0, idle, beaten = 0, stalled, launched, sampled = 0,
+    pinned = 0, quiet;
+  unsigned long long beats = 0, latest;
+  struct attendant__sample sample, last;
+  struct rusage rusage;
+  int worn = 0;
+  int status, err, fds[2], i, j, count, drains, stub = -1, in = -1, out = -1,
+    registry, enrolled = 0, control, controlled = 0, ready, triggers[3],
+    pressed = 0, graced = 0;
+  struct pollfd channels[12];
+  char buffer[2048];
+  sigset_t sigpipe;
+
+  say("[reaper/start]");
+
+  fds[0] = process->pipes[PIPE_STDOUT][0];
+  fds[1] = process->pipes[PIPE_STDERR][0];
+  registry = process->pipes[PIPE_REGISTRY][0];
+  control = process->pipes[PIPE_CONTROL][0];
+  memcpy(triggers, process->triggers, sizeof(triggers));
+
+  /* If we carry frames for a stable endpoint, standard out is not ours to
+   * drain, and standard in is ours to write, without blocking. When attached,
+   * the socket is both. A write to a plugin server process that has exited
+   * must not raise `SIGPIPE` in the host application, so we block it in this
+   * thread, where it will stay pending until the thread exits. */
+  if (process->journal.capacity) {
+    stub = process->endpoint[1];
+    if (process->attached) {
+      in = out = process->pipes[PIPE_CANARY][0];
+    } else {
+      in = process->pipes[PIPE_STDIN][1];
+      out = fds[0];
+      fds[0] = -1;
+    }
+    fcntl(in, F_SETFL, fcntl(in, F_GETFL) | O_NONBLOCK);
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, NULL);
+  }
+
+  /* Join the reaper launcher. We do not need the result. */
+  pthread_join(process->launcher, NULL);
+
+  /* If standard out belongs to the plugin stub, we leave it be. */
+  if (process->stdio == ATTENDANT_STDIO_STUB && ! process->journal.capacity) {
+    fds[0] = -1;
+  }
+
+  /* The restart is over. We have no sample of this plugin server process, nor
+   * anything it has written. */
+  launched = monotonic();
+  (void) pthread_mutex_lock(&process->mutex);
+  process->restarting = 0;
+  memset(&process->sample, 0, sizeof(process->sample));
+  process->tail.length = 0;
+  (void) pthread_cond_broadcast(&process->cond.running);
+  (void) pthread_mutex_unlock(&process->mutex);
+
+  /* We are running, unless the plugin server process has a control socket, in
+   * which case we are running when it says that it is ready. */
+  ready = control == -1;
+  if (ready) {
+    enter_service(process);
+  }
 
   /* Loop until the plugin server process exits. */
   do {
@@ -1082,13 +2841,14 @@ static void* reap(void *data)
     channels[CANARY].events = POLLHUP;
     channels[CANARY].revents = 0;
 
-    channels[REAPER].fd = process.pipes[PIPE_REAPER][0];
-    channels[CANARY].fd = process.pipes[PIPE_CANARY][0];
+    channels[REAPER].fd = process->pipes[PIPE_REAPER][0];
+    channels[CANARY].fd = process->pipes[PIPE_CANARY][0];
 
     /* We're going to simply drain standard out and standard error of the plugin
-     * server process. We do not log the output. It would be just as reasonable
-     * to close the pipes, or ignore them, but we drain them as long as we have
-     * this loop to drain them with. */
+     * server process. We keep the tail of standard error and log the output if
+     * asked. It would be just as reasonable to close the
+     * pipes, or ignore them, but we drain them as long as we have this loop to
+     * drain them with. */
 
     /* */
     count = 2;
@@ -1100,9 +2860,90 @@ static void* reap(void *data)
         count++;
       }
     }
+    drains = count;
+
+    /* And we carry frames. */
+    if (process->journal.capacity) {
+      courier_events(process, &channels[count], stub, in, out);
+      count += 3;
+    }
+
+    /* And we take registrations. */
+    if (registry != -1) {
+      enrolled = count;
+      channels[count].events = POLLIN;
+      channels[count].revents = 0;
+      channels[count].fd = registry;
+      count++;
+    }
+
+    /* And we listen for the word that the plugin server process is ready. */
+    if (control != -1) {
+      controlled = count;
+      channels[count].events = POLLIN;
+      channels[count].revents = 0;
+      channels[count].fd = control;
+      count++;
+    }
+
+    /* And we wait for pressure. `poll` ignores a trigger we do not have. */
+    if (process->pressure.window) {
+      pressed = count;
+      for (i = 0; i < 3; i++) {
+        channels[count].events = POLLPRI;
+        channels[count].revents = 0;
+        channels[count].fd = triggers[i];
+        count++;
+      }
+    }
 
     say("[reap/poll]");
 
+    /* If we have sent a `SIGTERM` we wake when the grace period is over, even
+     * though we may be woken sooner by chatter from the plugin server process,
+     * otherwise we wait for an event. */
+    if (sig == SIGKILL) {
+      timeout = grace - monotonic();
+      timeout = timeout < 0 ? 0 : timeout;
+    } else {
+      timeout = -1;
+    }
+
+    /* If we have an idle policy and have not started to kill, we also wake
+     * when the plugin server process will have been idle for long enough. */
+    if (process->idle && instance == 0) {
+      (void) pthread_mutex_lock(&process->mutex);
+      idle = process->active + process->idle - monotonic();
+      (void) pthread_mutex_unlock(&process->mutex);
+      timeout = idle < 0 ? 0 : (int) idle;
+    }
+
+    /* If we have a watchdog, we also wake when the plugin server process will
+     * have gone without a heartbeat for long enough. It is armed when the
+     * plugin server process says that it is ready. */
+    if (process->watchdog && ready && control != -1 && instance == 0) {
+      stalled = beaten + process->watchdog - monotonic();
+      stalled = stalled < 0 ? 0 : stalled;
+      if (timeout == -1 || stalled < timeout) {
+        timeout = (int) stalled;
+      }
+    }
+
+    /* If we sample, we also wake for the next sample, and if we are to
+     * recycle, we wake when it will have been quiet for long enough. */
+    if (process->recycle.interval && ! process->attached && instance == 0) {
+      quiet = worn ? 0 : sampled + process->recycle.interval - monotonic();
+      if (worn) {
+        (void) pthread_mutex_lock(&process->mutex);
+        quiet = process->active + process->recycle.quiet - monotonic();
+        (void) pthread_mutex_unlock(&process->mutex);
+      }
+      quiet = quiet < 0 ? 0 : quiet;
+      if (timeout == -1 || quiet < timeout) {
+        timeout = (int) quiet;
+      }
+    }
+
     HANDLE_EINTR(poll(channels, count, timeout), err);
 
     /* Not terribly concerned about errors here. If we encounter them, we ignore
@@ -1110,9 +2951,9 @@ static void* reap(void *data)
      *
      * TODO Test me. Write some junk to standard out.
      */
-    for (i = 2; i < count; i++) {
+    for (i = 2; i < drains; i++) {
       if (channels[i].revents & POLLIN) {
-        HANDLE_EINTR(read(channels[i].fd, buffer, sizeof(buffer)), err);
+        err = drain(process, channels[i].fd, buffer, sizeof(buffer));
         if (err == -1) {
           channels[i].revents = POLLHUP;
         }
@@ -1126,34 +2967,86 @@ static void* reap(void *data)
       }
     }
 
+    if (process->journal.capacity) {
+      courier(process, &channels[drains], &stub, &in, &out);
+    }
+
+    /* A datagram socket does not hang up when its peer exits, but should it
+     * report an error, we stop listening to it. */
+    if (registry != -1) {
+      if (channels[enrolled].revents & POLLIN) {
+        receive(process);
+      } else if (channels[enrolled].revents != 0) {
+        registry = -1;
+      }
+    }
+
+    /* The plugin server process sends an `R` when it is ready. Anything else
+     * it sends, we ignore. If it hangs up, it will never be ready. */
+    if (control != -1 && channels[controlled].revents) {
+      HANDLE_EINTR(read(control, buffer, sizeof(buffer)), err);
+      if (err > 0 && memchr(buffer, 'R', err) != NULL && ! ready) {
+        say("[reap/ready]");
+        ready = 1;
+        beaten = monotonic();
+        enter_service(process);
+      } else if (err == 0 || (err == -1 && errno != EAGAIN)) {
+        control = -1;
+      }
+    }
+
+    /* A pressure stall trigger that fires is counted and passed on to the
+     * plugin server process if it has a control socket. A trigger in error
+     * will only ever be in error, so we stop polling it. */
+    if (process->pressure.window) {
+      for (i = 0; i < 3; i++) {
+        if (channels[pressed + i].revents & (POLLERR | POLLNVAL)) {
+          triggers[i] = -1;
+        } else if (channels[pressed + i].revents & POLLPRI) {
+          say("[reap/pressure] %c", "mMc"[i]);
+          stressed(process, i);
+          if (control != -1) {
+            HANDLE_EINTR(send(control, &"mMc"[i], 1, MSG_NOSIGNAL), err);
+          }
+        }
+      }
+    }
+
     /* Note that, errors here make the situation hopeless. If we encounter
      * errors with the process monitoring pipes, we go to the shutdown state.
      */
 
-    /* Did the monitored process terminate? */
-    if (channels[CANARY].revents & POLLHUP) {
+    /* Did the monitored process terminate? A socket that is reset by a plugin
+     * server process that exits with our words unread is an error, but it is
+     * also a hang up. */
+    if ((channels[CANARY].revents & POLLHUP)
+        || (process->attached && (channels[CANARY].revents & POLLERR))) {
       say("[reap/hangup]");
       hangup = 1;
     } else if (channels[CANARY].revents != 0) {
-      set_error(REAPER_UNEXPECTED_CANARY_PIPE_EVENT);
+      set_error(process, REAPER_UNEXPECTED_CANARY_PIPE_EVENT);
     }
 
     /* Did we get an instance number from the plugin stub? */
     if (channels[REAPER].revents & POLLIN) {
       /* Read the message from the user. */
-      HANDLE_EINTR(read(process.pipes[PIPE_REAPER][0], input, sizeof(input)), err);
+      HANDLE_EINTR(read(process->pipes[PIPE_REAPER][0], input, sizeof(input)), err);
 
       if (err != sizeof(input)) {
         /* Any error reading the instance pipe means we shutdown for good. */
         if (err == -1) {
-          set_error(REAPER_CANNOT_READ_REAPER_PIPE);
+          set_error(process, REAPER_CANNOT_READ_REAPER_PIPE);
         } else {
-          set_error(REAPER_TRUNCATED_READ_REAPER_PIPE);
+          set_error(process, REAPER_TRUNCATED_READ_REAPER_PIPE);
         }
 
       } else if (input[0] == -1) {
         say("[reap/shutdown]");
         shutdown = 1;
+        /* Tell a plugin server process with a control socket to shut down. */
+        if (control != -1) {
+          HANDLE_EINTR(send(control, "S", 1, MSG_NOSIGNAL), err);
+        }
       } else if (input[0] > instance) {
         /* We will restart if we get an instance number higher than the static
          * instance number. If we get a `-1` we shutdown. */
@@ -1162,20 +3055,23 @@ static void* reap(void *data)
         /* */
       }
     } else if (channels[REAPER].revents != 0) {
-      set_error(REAPER_UNEXPECTED_REAPER_PIPE_EVENT);
+      set_error(process, REAPER_UNEXPECTED_REAPER_PIPE_EVENT);
     }
 
     /* If we're getting unexpected errors from reading the pipes, we've entered
      * an unstable state. We don't want the plugin attendant itself to hang, and
      * it can't seem to rely on useful behavior from pipes, so we nuke it from
      * orbit. It's the only way to be sure. */
-    if (process.errors.attendant) {
+    if (process->errors.attendant) {
       /* Trigger a shutdown. */
       shutdown = 1;
       /* Leave the reaper pipe polling loop. */
       hangup = 1;
-      /* Nuke it from orbit. It's the only way to be sure. */
-      kill(process.pid, SIGKILL);
+      /* Nuke it from orbit. It's the only way to be sure. Unless it is shared,
+       * and not ours to nuke. */
+      if (! process->attached) {
+        kill(process->pid, SIGKILL);
+      }
     }
 
     /* Note if we got a shutdown from the instance pipe. The next time we detect
@@ -1187,28 +3083,169 @@ static void* reap(void *data)
      * see that the process will never run again. 
      */
     if (shutdown) {
-      (void) pthread_mutex_lock(&process.mutex);
-      process.shutdown = 1;
-      (void) pthread_cond_signal(&process.cond.running);
-      (void) pthread_cond_signal(&process.cond.shutdown);
-      (void) pthread_mutex_unlock(&process.mutex);
+      (void) pthread_mutex_lock(&process->mutex);
+      process->shutdown = 1;
+      (void) pthread_cond_broadcast(&process->cond.running);
+      (void) pthread_cond_signal(&process->cond.shutdown);
+      notify(process);
+      (void) pthread_mutex_unlock(&process->mutex);
       shutdown = 0;
     }
 
-    /* If we are restarting but have not received a hang up, kill. First with a
-     * `SIGTERM` then with a `SIGKILL`. We give the process a half second to
-     * shutdown after a `SIGTERM`, but wait indefinately after the `SIGKILL`. */
-    if (instance > 0 && !hangup) {
-      kill(process.pid, sig);
-      timeout = sig == SIGTERM ? input[1] : -1;
-      sig = SIGKILL;
-      continue;
+    /* If no one has called `ready` or `retry` for the idle period, we stop the
+     * plugin server process as we would for a `retry`, giving it the half
+     * second we ask of a well behaved plugin server process. When it exits, we
+     * go dormant instead of calling the starter. */
+    if (process->idle && instance == 0 && !hangup) {
+      (void) pthread_mutex_lock(&process->mutex);
+      if (! process->shuttingdown
+          && monotonic() - process->active >= process->idle) {
+        say("[reap/idle]");
+        process->idling = 1;
+        instance = INT_MAX;
+        input[1] = 500;
+      }
+      (void) pthread_mutex_unlock(&process->mutex);
     }
-  /* Repeat until the plugin server process exits. */
+
+    /* If the heartbeat has not moved since we last looked, and we have waited
+     * long enough, the plugin server process is hung. We restart it as if a
+     * plugin stub thread had called `retry`, with the half second we give an
+     * idle plugin server process to exit, though a hung plugin server process
+     * is likely to need the `SIGKILL`. */
+    if (process->watchdog && ready && control != -1 && instance == 0
+        && !hangup) {
+      latest = __atomic_load_n(&process->heartbeat->beats, __ATOMIC_ACQUIRE);
+      if (latest != beats) {
+        beats = latest;
+        beaten = monotonic();
+      } else if (monotonic() - beaten >= process->watchdog) {
+        say("[reap/hung]");
+        instance = INT_MAX;
+        input[1] = 500;
+      }
+    }
+
+    /* Sample the plugin server process and check the recycle policy. */
+    if (process->recycle.interval && ! process->attached && instance == 0
+        && !hangup && ! worn
+        && monotonic() >= sampled + process->recycle.interval) {
+      (void) pthread_mutex_lock(&process->mutex);
+      last = process->sample;
+      (void) pthread_mutex_unlock(&process->mutex);
+      if (take_sample(process, &sample, &last) == 0) {
+        sample.uptime = sample.taken - launched;
+        (void) pthread_mutex_lock(&process->mutex);
+        process->sample = sample;
+        (void) pthread_mutex_unlock(&process->mutex);
+        if (process->recycle.rss && sample.rss > process->recycle.rss) {
+          say("[reap/worn] rss %lld", sample.rss);
+          worn = 1;
+        }
+        if (process->recycle.cpu && sample.cpu >= process->recycle.cpu) {
+          pinned = pinned ? pinned : sample.taken;
+          if (sample.taken - pinned >= process->recycle.pinned) {
+            say("[reap/worn] cpu %d", sample.cpu);
+            worn = 1;
+          }
+        } else {
+          pinned = 0;
+        }
+      }
+      sampled = monotonic();
+      if (process->recycle.lifetime
+          && sampled - launched >= process->recycle.lifetime) {
+        say("[reap/worn] lifetime");
+        worn = 1;
+      }
+    }
+
+    /* Recycle a worn plugin server process when it is quiet. */
+    if (worn && instance == 0 && !hangup) {
+      (void) pthread_mutex_lock(&process->mutex);
+      if (! process->shuttingdown
+          && monotonic() - process->active >= process->recycle.quiet) {
+        say("[reap/recycle]");
+        process->recycling = 1;
+        instance = INT_MAX;
+        input[1] = 500;
+      }
+      (void) pthread_mutex_unlock(&process->mutex);
+    }
+
+    /* A shared plugin server process we are attached to is not ours to kill,
+     * so we restart by hanging up on it. */
+    if (instance > 0 && !hangup && process->attached) {
+      say("[reap/detach]");
+      hangup = 1;
+      continue;
+    }
+
+    /* If we are restarting but have not received a hang up, kill. First with a
+     * `SIGTERM` then with a `SIGKILL`. We give the process the number of
+     * milliseconds given to `retry` to shutdown after a `SIGTERM`, measured
+     * against the monotonic clock, so that draining standard out does not cut
+     * it short, but wait indefinately after the `SIGKILL`. A negative grace
+     * period, as sent by `scram`, is no grace period at all. */
+    if (instance > 0 && !hangup
+        && (sig == SIGTERM || (sig == SIGKILL && monotonic() >= grace))) {
+      say("[reap/kill] %d", sig);
+      /* If it was given time to go quietly and did not, it is hung. Note why,
+       * while we can. Without a grace period, as from `scram` or `retry(0)`,
+       * it had no time to go, and we would only slow the kill and overwrite
+       * the last real snapshot. */
+      if (sig == SIGKILL && graced) {
+        snap(process);
+      }
+      kill(process->pid, sig);
+      if (sig == SIGTERM) {
+        graced = input[1] > 0;
+        grace = monotonic() + (graced ? input[1] : 0);
+        sig = SIGKILL;
+      } else {
+        sig = 0;
+      }
+      continue;
+    }
+  /* Repeat until the plugin server process exits. */
   } while (!hangup);
 
   say("[reap/hungup]");
 
+  /* Keep what the plugin server process wrote as it went down, which is likely
+   * why it went down. Whatever it left to children that still have the pipes
+   * open, we do not wait for. */
+  if (process->tail.size || process->logbook.path) {
+    for (i = 0; i < 2; i++) {
+      channels[0].fd = i == 0 ? process->pipes[PIPE_STDERR][0]
+        : process->stdio == ATTENDANT_STDIO_LOG && ! process->journal.capacity
+        ? process->pipes[PIPE_STDOUT][0] : -1;
+      channels[0].events = POLLIN;
+      do {
+        HANDLE_EINTR(poll(channels, 1, 0), err);
+        if (err == 1 && (channels[0].revents & POLLIN)) {
+          err = drain(process, channels[0].fd, buffer, sizeof(buffer));
+        } else {
+          err = 0;
+        }
+      } while (err > 0);
+    }
+    settle(process);
+  }
+
+  /* Take the registrations sent before the plugin server process exited. */
+  if (registry != -1) {
+    while (receive(process))
+      ;
+  }
+  close_pipe(process, PIPE_REGISTRY, 0);
+  close_pipe(process, PIPE_CONTROL, 0);
+
+  /* Answer what we cannot replay. */
+  if (process->journal.capacity) {
+    strand(process);
+  }
+
   /* TODO Log restart reason? No. We have no good reason. Or, hmm... Sure, why
    * not? */
 
@@ -1216,8 +3253,12 @@ static void* reap(void *data)
    * A host application that changes `SIGCHLD` disposition every now and again
    * is far to shabby to support. */
 
-  /* If we are waitable use `waitpid`. */
-  if (process.waitable) {
+  /* If we are attached, there is no child to wait on. We hang up, so that the
+   * shared plugin server process can drop our reference. Otherwise, if we are
+   * waitable use `waitpid`. */
+  if (process->attached) {
+    close_pipe(process, PIPE_CANARY, 0);
+  } else if (process->waitable) {
     /* Our host application might also be waiting on the pid, by using a global
      * wait to wait until any child terminates. That means that the host
      * application might be the one to reap the child. If that is the case, then
@@ -1227,8 +3268,28 @@ static void* reap(void *data)
      * So, ECHILD is not really an error, we are retrying on EINTR, so that
      * leaves EINVAL, which we're not going to trigger. Let's move on.  */
 
-    /* We wait for the child process to exit, blocking until it exits. */
-    HANDLE_EINTR(waitpid(process.pid, &status, 0), err);
+    /* We wait for the child process to exit, blocking until it exits, and note
+     * what it used. */
+    HANDLE_EINTR(wait4(process->pid, &status, 0, &rusage), err);
+    if (err == process->pid) {
+      (void) pthread_mutex_lock(&process->mutex);
+      process->usage.pid = process->pid;
+      process->usage.status = status;
+      process->usage.user = rusage.ru_utime.tv_sec * 1000LL
+        + rusage.ru_utime.tv_usec / 1000;
+      process->usage.system = rusage.ru_stime.tv_sec * 1000LL
+        + rusage.ru_stime.tv_usec / 1000;
+#ifdef __APPLE__
+      process->usage.maxrss = rusage.ru_maxrss;
+#else
+      process->usage.maxrss = rusage.ru_maxrss * 1024LL;
+#endif
+      process->usage.minflt = rusage.ru_minflt;
+      process->usage.majflt = rusage.ru_majflt;
+      process->usage.nvcsw = rusage.ru_nvcsw;
+      process->usage.nivcsw = rusage.ru_nivcsw;
+      (void) pthread_mutex_unlock(&process->mutex);
+    }
   /* &mdash; */
   } else {
     /* There is a theoretical race condition, where the process id may be
@@ -1270,19 +3331,19 @@ static void* reap(void *data)
      */
 
     /* Loop while the pid is still valid. */
-    while (getpgid(process.pid) != -1) {
+    while (getpgid(process->pid) != -1) {
       /* Wait for a quarter of a second and check the pid again. We use a
        * condition that is used only for this test. We want the timeout, not the
        * signaling. The wait will cause us to release the mutex. */
-      pthread_mutex_lock(&process.mutex);
-      pthread_cond_waitforabit(&process.cond.getgpid, &process.mutex, 250);
-      pthread_mutex_unlock(&process.mutex);
+      pthread_mutex_lock(&process->mutex);
+      pthread_cond_waitforabit(&process->cond.getgpid, &process->mutex, 250);
+      pthread_mutex_unlock(&process->mutex);
       /* */
     }
   }
 
   /* Cleanup. */
-  signal_termination();
+  signal_termination(process);
 
   /* The thread return value is unused. */
   return NULL;
@@ -1290,45 +3351,117 @@ static void* reap(void *data)
   /* &mdash; */
 }
 
+/* Count a crash against the crash loop policy and decide when the next start
+ * may launch. A lone crash in the window restarts at once. Each further
+ * crash doubles the wait, up to the maximum, and we wait somewhere between half
+ * and all of it, so that a crowd of plugins that crashed together do not
+ * restart together. If we hit the limit, we open the circuit and wait out the
+ * cool down. Called with the mutex held. */
+static void crashed(struct attendant__process *process) {
+  long long now = monotonic();
+  int i, count = 0, delay = 0;
+
+  if (process->policy.window <= 0) {
+    return;
+  }
+
+  process->crashes[process->crashed++ % CRASH_RING] = now;
+  for (i = 0; i < CRASH_RING; i++) {
+    if (process->crashes[i] && now - process->crashes[i] < process->policy.window) {
+      count++;
+    }
+  }
+
+  if (process->policy.limit > 0 && count >= process->policy.limit) {
+    say("[crashed/tripped] %d", count);
+    process->tripped = 1;
+    delay = process->policy.cooldown;
+  } else if (count > 1) {
+    delay = process->policy.initial;
+    for (i = 2; i < count && delay < INT_MAX / 2; i++) {
+      delay *= 2;
+    }
+    if (process->policy.maximum > 0 && delay > process->policy.maximum) {
+      delay = process->policy.maximum;
+    }
+    delay = delay / 2 + rand_r(&process->seed) % (delay / 2 + 1);
+  }
+
+  process->chilled = delay ? now + delay : 0;
+}
+
+/* Call the starter of the default instance or of a handle. */
+static void invoke_starter(struct attendant__process *process, int restart,
+    int uptime) {
+  if (process->starter_r) {
+    process->starter_r(process, process->context, restart, uptime);
+  } else {
+    process->starter(restart, uptime);
+  }
+}
+
 /* Cleanup when we fail to start the launcher thread, fail to launch the plugin
  * server program, or detect that the plugin server process has exited. */
 
 /* */
-static void signal_termination() {
-  int instance, shutdown, shuttingdown;
+static void signal_termination(struct attendant__process *process) {
+  int instance, shutdown, shuttingdown, dormant;
 
   /* Don't need the process identifier anymore. */
-  process.pid = 0;
+  process->pid = 0;
 
   /* Dip into our mutex. */
-  (void) pthread_mutex_lock(&process.mutex);
+  (void) pthread_mutex_lock(&process->mutex);
 
   /* Take note of whether we sould invoke the abend handler. Reset for an
    * orderly restart. Do not reset shutdown here, only stopped. */
-  process.restarting = !process.shuttingdown;
-  process.running = 0;
-  instance = process.instance;
+  process->restarting = !process->shuttingdown && !process->idling;
+  process->running = 0;
+  instance = process->instance;
+
+  /* If we stopped the plugin server process for idleness, we wait for someone
+   * to call `ready` or `retry`, unless we are shutting down anyway. */
+  if (process->idling) {
+    say("[abend/dormant]");
+    process->idling = 0;
+    process->dormant = !process->shuttingdown;
+  }
+
+  /* Count the crash, possibly opening the circuit, before we wake anyone. A
+   * plugin server process we recycled did not crash. */
+  if (process->restarting && !process->recycling) {
+    crashed(process);
+  }
+  process->recycling = 0;
 
   /* We are shutting down after a failed start, so we're never going to trigger
    * the shutdown in the reaper thread. */
-  if (process.shuttingdown && !process.shutdown) {
-    process.shutdown = 1;
-    (void) pthread_cond_signal(&process.cond.shutdown);
+  if (process->shuttingdown && !process->shutdown) {
+    process->shutdown = 1;
+    (void) pthread_cond_signal(&process->cond.shutdown);
   }
 
   /* Signal any thread waiting on a running state change. */
-  (void) pthread_cond_signal(&process.cond.running);
+  (void) pthread_cond_broadcast(&process->cond.running);
+  notify(process);
+
+  dormant = process->dormant;
 
   /* Undip. */
-  (void) pthread_mutex_unlock(&process.mutex);
+  (void) pthread_mutex_unlock(&process->mutex);
 
+  /* If we went dormant, a connection or a summons can wake us as well as a call
+   * to `ready`. */
+  if (dormant) {
+    arm(process);
+  }
 
   /* If we've decided to try a restart, call the abend handler. */
-  if (process.restarting) {
+  if (process->restarting) {
     say("[abend/restarting]");
 
     /* Call the starter to restarter the server process. */
-    process.starter(1, time(NULL) - process.start_time);
+    invoke_starter(process, 1, time(NULL) - process->start_time);
 
     /* If the abend handler did not call start, then it has decided to shutdown.
      * We are no longer restarting, and we can signal a process state change to
@@ -1338,44 +3471,193 @@ static void signal_termination() {
      * that the process has shutdown. Other functions wait for the process to
      * run again, and this will wake them so then can see that the process will
      * never run again. */
-    (void) pthread_mutex_lock(&process.mutex);
-    if (process.instance == instance) {
+    (void) pthread_mutex_lock(&process->mutex);
+    if (process->instance == instance) {
       say("[abend/shutdown]");
-      process.restarting = 0;
-      process.shutdown = 1;
-      (void) pthread_cond_signal(&process.cond.running);
-      (void) pthread_cond_signal(&process.cond.shutdown);
+      process->restarting = 0;
+      process->shutdown = 1;
+      process->chilled = 0;
+      (void) pthread_cond_broadcast(&process->cond.running);
+      (void) pthread_cond_signal(&process->cond.shutdown);
+      notify(process);
     }
-    (void) pthread_mutex_unlock(&process.mutex);
+    (void) pthread_mutex_unlock(&process->mutex);
   } else {
     say("[abend/exit]");
   }
 }
 
+/* ### Activation
+ *
+ * While we are dormant, the activator thread waits for a connection to the
+ * listener, if we activate. When one arrives, it calls the starter, as `ready`
+ * would, and the connection waits in the backlog for the plugin server process
+ * to accept it. It does the same when summoned by a call to `ready_until` or
+ * `request_retry`, which must not run the starter on the calling thread.
+ * Whoever else ends our dormancy wakes the activator thread through the
+ * activate pipe, and it leaves.
+ */
+
+/* Wake the activator thread. Called with the mutex held wherever we stop
+ * being dormant or summon it. */
+static void rouse(struct attendant__process *process) {
+  int err;
+  char ch = 0;
+  if (process->pipes[PIPE_ACTIVATE][1] != -1) {
+    HANDLE_EINTR(write(process->pipes[PIPE_ACTIVATE][1], &ch, 1), err);
+  }
+}
+
+/* &#9824; */
+static void* activation(void *data) {
+  struct attendant__process *process = data;
+  struct pollfd channels[2];
+  char buffer[64];
+  int err;
+
+  say("[activate/start]");
+
+  for (;;) {
+    channels[0].fd = process->activate ? process->listener : -1;
+    channels[0].events = POLLIN;
+    channels[0].revents = 0;
+    channels[1].fd = process->pipes[PIPE_ACTIVATE][0];
+    channels[1].events = POLLIN;
+    channels[1].revents = 0;
+
+    HANDLE_EINTR(poll(channels, 2, -1), err);
+    if (err == -1) {
+      break;
+    }
+
+    /* Drain the activate pipe. A wake up meant for an activator thread before
+     * us costs us one more trip around the loop. */
+    do {
+      HANDLE_EINTR(read(process->pipes[PIPE_ACTIVATE][0], buffer,
+        sizeof(buffer)), err);
+    } while (err > 0);
+
+    pthread_mutex_lock(&process->mutex);
+    if (! process->dormant || process->shuttingdown) {
+      pthread_mutex_unlock(&process->mutex);
+      break;
+    }
+    if ((channels[0].revents & POLLIN) || process->summoned) {
+      process->dormant = 0;
+      process->summoned = 0;
+      pthread_mutex_unlock(&process->mutex);
+      say("[activate/connection]");
+      awaken(process);
+      break;
+    }
+    pthread_mutex_unlock(&process->mutex);
+  }
+
+  say("[activate/exit]");
+
+  return NULL;
+}
+
+/* The previous activator thread has left, or is about to, because we were not
+ * dormant when we became dormant again. */
+static void arm(struct attendant__process *process) {
+  if (process->activating) {
+    pthread_join(process->activator, NULL);
+  }
+  process->activating =
+    pthread_create(&process->activator, NULL, activation, process) == 0;
+}
+
 /* ### Ready
  *
- * `ready` &mdash; Called by the plugin stub after the initial call to start to
+ * A dormant plugin server process is launched by calling the starter, as if
+ * the library had just loaded. If the starter does not call `start`, we take
+ * it that we should shutdown, as we do when the starter does not restart.
+ */
+
+/* &#9824; */
+static void awaken(struct attendant__process *process) {
+  int instance;
+
+  say("[ready/awaken]");
+
+  pthread_mutex_lock(&process->mutex);
+  instance = process->instance;
+  pthread_mutex_unlock(&process->mutex);
+
+  invoke_starter(process, 0, 0);
+
+  pthread_mutex_lock(&process->mutex);
+  if (process->instance == instance) {
+    process->shutdown = 1;
+    pthread_cond_broadcast(&process->cond.running);
+    pthread_cond_signal(&process->cond.shutdown);
+    notify(process);
+  }
+  pthread_mutex_unlock(&process->mutex);
+}
+
+/* `ready` &mdash; Called by the plugin stub after the initial call to start to
  * wait for the plugin server process to start.
  */
 
 /* &#9824; */
-static int ready() {
+int attendant_ready_until(struct attendant__process *process,
+    long long deadline) {
   int ready;
 
   /* We block until either we are ready or have entered the shutdown state. If
-   * we enter the shutdown state, we know that we will never run again. */
-  pthread_mutex_lock(&process.mutex);
-  while (! process.running && ! process.shutdown) {
-    pthread_cond_wait(&process.cond.running, &process.mutex);
+   * we enter the shutdown state, we know that we will never run again. We do
+   * not block at all while the crash loop circuit is open, and we stop blocking
+   * when the deadline passes.
+   *
+   * This is also where demand is felt. We note the time for the idle policy,
+   * and if the plugin server process is dormant, the first thread to notice
+   * calls the starter, as if the library had just loaded. The starter and the
+   * chill of `start` can block, so a caller with a deadline summons the
+   * activator thread to call the starter instead. */
+  pthread_mutex_lock(&process->mutex);
+  process->active = monotonic();
+  for (;;) {
+    if (process->dormant && ! process->shuttingdown) {
+      if (deadline < 0) {
+        process->dormant = 0;
+        process->summoned = 0;
+        rouse(process);
+        pthread_mutex_unlock(&process->mutex);
+        awaken(process);
+        pthread_mutex_lock(&process->mutex);
+        continue;
+      }
+      if (! process->summoned) {
+        process->summoned = 1;
+        rouse(process);
+      }
+    }
+    if (process->running || process->shutdown || process->tripped
+        || ! pthread_cond_waituntil(&process->cond.running, &process->mutex,
+          deadline)) {
+      break;
+    }
   }
-  ready = ! process.shutdown;
-  pthread_mutex_unlock(&process.mutex);
+  ready = process->shutdown ? 0
+        : process->running ? 1
+        : process->tripped ? ATTENDANT_CIRCUIT_OPEN : ATTENDANT_NOT_YET;
+  pthread_mutex_unlock(&process->mutex);
 
   say("[ready/exit]");
 
   return ready;
 }
 
+/* Block without a deadline. Callers take the result for a boolean, so an open
+ * circuit is false, and `errors` says why. */
+
+/* &#9824; */
+int attendant_ready(struct attendant__process *process) {
+  return attendant_ready_until(process, -1) == 1;
+}
+
 /* ### Retry */
 
 /* After initialization, the plugin server process is supposed to run, without
@@ -1470,41 +3752,53 @@ static int ready() {
  * the reaper process is send the instance number through the instance pipe.
  */
 
-/* &#9824; */
-static int retry(int milliseconds) {
-  int err, *instance, terminate = 0, message[2];
-
-  /* Get the current value of the thread local instance. */
-  instance = ((int*) pthread_getspecific(process.key)); 
-  
-  /* If there is no instance, we allocate one. The cleanup function associated
-   * with the thread local key will free the pointer at thread exit. */
+/* Get the thread local instance, the last instance of the plugin server
+ * process this thread knows to be running. If there is none, we allocate one.
+ * The cleanup function associated with the thread local key will free the
+ * pointer at thread exit. Returns `NULL` if we cannot allocate. */
+static int *thread_instance(struct attendant__process *process) {
+  int *instance = ((int*) pthread_getspecific(process->key));
   if (instance == NULL) {
     instance = malloc(sizeof(int));
+    if (instance == NULL) {
+      return NULL;
+    }
     *instance = 1;
-    (void) pthread_setspecific(process.key, instance);
+    (void) pthread_setspecific(process->key, instance);
+  }
+  return instance;
+}
+
+/* &#9824; */
+int attendant_retry_until(struct attendant__process *process, int milliseconds,
+    long long deadline) {
+  int err, *instance, terminate = 0, message[2], status;
+
+  /* Get the current value of the thread local instance. Without one, we cannot
+   * tell which instance we are reporting, so we only wait. */
+  instance = thread_instance(process);
+  if (instance == NULL) {
+    return attendant_ready_until(process, deadline);
   }
 
   /* Dip into our mutex. */
-  (void) pthread_mutex_lock(&process.mutex);
+  (void) pthread_mutex_lock(&process->mutex);
 
-  fprintf(stderr, "Process instance is %d and %d term %d\n", process.instance, *instance, terminate);
   /* If the process instance equals our thread local instance and the process is
    * running, then we are the first stub thread to report that this instance has
    * died. */
-  if (process.instance == *instance && process.running) {
+  if (process->instance == *instance && process->running) {
     /* We are the only client thread that can reach this point. We mark the
      * plugin server process as not running. We will send a message to the
      * reaper thread to restart the plugin server thread, but outside of this
      * mutex. */
-    process.running = 0;
+    process->running = 0;
     terminate = 1;
     /* */
   }
-  fprintf(stderr, "Process instance is %d and %d term %d\n", process.instance, *instance, terminate);
 
   /* Undip. */
-  (void) pthread_mutex_unlock(&process.mutex);
+  (void) pthread_mutex_unlock(&process->mutex);
 
   /* Send the instance number through the pipe. This wakes the reaper thread and
    * tells it that the given instance has hung. The reaper process will kill the
@@ -1517,18 +3811,19 @@ static int retry(int milliseconds) {
 
     message[0] = *instance;
     message[1] = milliseconds;
-    HANDLE_EINTR(write(process.pipes[PIPE_REAPER][1], message, sizeof(message)), err); 
+    HANDLE_EINTR(write(process->pipes[PIPE_REAPER][1], message, sizeof(message)), err); 
   }
 
   /* Wait for the server to be ready again. */
-  if (ready()) {
+  status = attendant_ready_until(process, deadline);
+  if (status == 1) {
     /* Grab the instance number state. */
-    (void) pthread_mutex_lock(&process.mutex);
-    *instance = process.instance;
-    (void) pthread_mutex_unlock(&process.mutex);
+    (void) pthread_mutex_lock(&process->mutex);
+    *instance = process->instance;
+    (void) pthread_mutex_unlock(&process->mutex);
 
     /* Stash the instance number in thread local storage. */
-    (void) pthread_setspecific(process.key, instance);
+    (void) pthread_setspecific(process->key, instance);
 
     say("[retry/again]");
 
@@ -1536,6 +3831,15 @@ static int retry(int milliseconds) {
     return 1;
   }
 
+  /* The circuit is open, so there is no point waiting, or we ran out of time
+   * to wait. We have not updated our thread local instance, so if this thread
+   * calls `retry` again, it will wait for the restart already underway, not
+   * ask for another one. */
+  if (status != 0) {
+    say("[retry/later] %d", status);
+    return status;
+  }
+
   say("[retry/shutdown]");
 
   /* Return false if we've shutdown, indicating that a retry of IPC is
@@ -1544,6 +3848,37 @@ static int retry(int milliseconds) {
   /* */
 }
 
+/* Block without a deadline. As with `ready`, an open circuit is false. */
+
+/* &#9824; */
+int attendant_retry(struct attendant__process *process, int milliseconds) {
+  return attendant_retry_until(process, milliseconds, -1) == 1;
+}
+
+/* Take note of the running plugin server process as this thread's own, as
+ * `retry` does when it returns true, for those who learn that it is running
+ * some other way. Returns its instance number, or zero if it is not running.
+ */
+
+/* &#9824; */
+int attendant_acknowledge(struct attendant__process *process) {
+  int *instance, running;
+
+  instance = thread_instance(process);
+  if (instance == NULL) {
+    return 0;
+  }
+
+  (void) pthread_mutex_lock(&process->mutex);
+  running = process->running ? process->instance : 0;
+  if (running) {
+    *instance = running;
+  }
+  (void) pthread_mutex_unlock(&process->mutex);
+
+  return running;
+}
+
 /* ### Shutdown
  *
  * `shutdown` &mdash; Orderly shutdown is when we tell the plugin attendant to
@@ -1583,37 +3918,65 @@ static int retry(int milliseconds) {
  * elaborate shutdown.
  */
 
-/* */
-static int shutdown() {
-  int err, running, shutdown[2] = { -1, 0 };
+/* `request_shutdown` &mdash; Initiate shutdown without waiting. Returns false
+ * if we could not tell the reaper thread. */
+
+/* &#9824; */
+int attendant_request_shutdown(struct attendant__process *process) {
+  int err, shutdown[2] = { -1, 0 };
 
   /* Tell the reaper thread that shutdown has come. It will not attempt to
    * restart the library server process the next time it exits. */
-  HANDLE_EINTR(write(process.pipes[PIPE_REAPER][1], shutdown, sizeof(shutdown)), err);
+  HANDLE_EINTR(write(process->pipes[PIPE_REAPER][1], shutdown, sizeof(shutdown)), err);
+
+  (void) pthread_mutex_lock(&process->mutex);
+
+  process->shuttingdown = 1;
+
+  /* If we're dormant, there is no reaper to tell, so we are shutdown. */
+  if (process->dormant) {
+    process->dormant = 0;
+    process->summoned = 0;
+    rouse(process);
+    process->shutdown = 1;
+    (void) pthread_cond_broadcast(&process->cond.running);
+    (void) pthread_cond_signal(&process->cond.shutdown);
+    notify(process);
+  }
+
+  /* If we're chilling before a restart, let's stop chilling. The chill in
+   * `start` checks the shutting down flag, so it will not go back to sleep. */
+  (void) pthread_cond_signal(&process->cond.chilling);
+
+  (void) pthread_mutex_unlock(&process->mutex);
+
+  say("[shutdown/requested]");
+
+  return err != -1;
+}
+
+/* */
+int attendant_shutdown(struct attendant__process *process) {
+  int running;
+
+  attendant_request_shutdown(process);
 
   /* Dip into our mutex to check and see we're not in the middle of a server
    * restart. If we are in the middle of a server restart, we may as well wait
    * for it to finish before we continue. */
-  (void) pthread_mutex_lock(&process.mutex);
-
-  process.shuttingdown = 1;
-
-  /* If we're chilling before a restart, let's stop chilling. TODO: We could
-   * have a count of millis to chill, which we set to zero, handling the case of
-   * spurious wake-ups. */
-  (void) pthread_cond_signal(&process.cond.chilling);
+  (void) pthread_mutex_lock(&process->mutex);
 
   /* Wait until we're no longer restarting. */
-  while (process.restarting) {
+  while (process->restarting) {
     say("[shutdown/restarting]");
-    (void) pthread_cond_wait(&process.cond.running, &process.mutex);
+    (void) pthread_cond_wait(&process->cond.running, &process->mutex);
   }
 
   /* Wait for the shutdown flag to set, otherwise a call to done is going to
    * report an invalid state. */
-  while (! process.shutdown) {
+  while (! process->shutdown) {
     say("[shutdown/shutdown]");
-    (void) pthread_cond_wait(&process.cond.shutdown, &process.mutex);
+    (void) pthread_cond_wait(&process->cond.shutdown, &process->mutex);
   }
 
   /* If we invoke the user abend function, and it doesn't want to restart, then
@@ -1629,9 +3992,9 @@ static int shutdown() {
    */
 
   /* Note if we are running. */
-  running = process.running;
+  running = process->running;
 
-  (void) pthread_mutex_unlock(&process.mutex);
+  (void) pthread_mutex_unlock(&process->mutex);
 
   say("[shutdown/exit]");
 
@@ -1639,26 +4002,24 @@ static int shutdown() {
 }
 
 /* Want a timeout to escalate to kill. Or does kill happen in here? */
-static int done(int timeout) {
+int attendant_done(struct attendant__process *process, int timeout) {
+  long long deadline = timeout > 0 ? monotonic() + timeout : -1;
   int done, shutdown;
 
-  pthread_mutex_lock(&process.mutex);
-  if ((shutdown = process.shutdown)) {
+  pthread_mutex_lock(&process->mutex);
+  if ((shutdown = process->shutdown)) {
     /* TODO Is this what we're waiting for? */
-    /* TODO Need to fix timeouts to that they try again if they exit early. */
-    if (process.running) {
-      do {
-        pthread_cond_waitforabit(&process.cond.running, &process.mutex, timeout);
-      } while (process.running && timeout <= 0);
-    }
+    while (process->running
+        && pthread_cond_waituntil(&process->cond.running, &process->mutex,
+          deadline));
   }
-  done = ! process.running;
-  pthread_mutex_unlock(&process.mutex);
+  done = ! process->running;
+  pthread_mutex_unlock(&process->mutex);
 
   /* TODO Are you going to join a destroyed process? No, but multiple joins are
    * bad. TK Document that you can only call this from one thread. */
   if (done) {
-    pthread_join(process.reaper, NULL);
+    pthread_join(process->reaper, NULL);
   }
 
   say("[done/exit]");
@@ -1671,12 +4032,12 @@ static int done(int timeout) {
 /* TODO What is the correct return value? */
 
 /* */
-static int scram() {
+int attendant_scram(struct attendant__process *process) {
   int err, scram[] = { INT_MAX, -1 };
   /* Must be able to send two shutdowns. Then poll must be able to detect that
    * not all of the stuff has been read, poll must not block if the buffer is
    * not drained. */
-  if (shutdown()) {
+  if (attendant_shutdown(process)) {
     /* Send a huge instance number down the pipe. This is going to trigger a
      * restart, an unrecoverable one, and a last one. No other `scram` or
      * `retry` will be able to trigger a restart, because they will not be able
@@ -1685,7 +4046,7 @@ static int scram() {
      *
      * We'll try a SIGTERM term first, as usual, then a SIGKILL.
      */
-    HANDLE_EINTR(write(process.pipes[PIPE_REAPER][1], scram, sizeof(scram)), err);
+    HANDLE_EINTR(write(process->pipes[PIPE_REAPER][1], scram, sizeof(scram)), err);
 
     say("[scram/initiated]");
 
@@ -1697,11 +4058,181 @@ static int scram() {
   return 0;
 }
 
-/* Return the last error recorded by the attendant. */
+/* ### Event Loop
+ *
+ * A host application with a single threaded event loop cannot park a thread in
+ * `ready` or `shutdown`. It can poll the read end of the notify pipe, and when
+ * it is readable, call `poll_state` to drain it and find out where we stand.
+ */
 
 /* &#9824; */
-static struct attendant__errors errors() {
-  return process.errors;
+attendant__pipe_t attendant_fd(struct attendant__process *process) {
+  return process->pipes[PIPE_NOTIFY][0];
+}
+
+/* &#9824; */
+attendant__pipe_t attendant_endpoint(struct attendant__process *process) {
+  return process->endpoint[0];
+}
+
+/* &#9824; */
+int attendant_poll_state(struct attendant__process *process) {
+  char buffer[64];
+  int err, state;
+
+  /* Drain first, so that a change after we look is not lost. */
+  do {
+    HANDLE_EINTR(read(process->pipes[PIPE_NOTIFY][0], buffer, sizeof(buffer)), err);
+  } while (err > 0);
+
+  pthread_mutex_lock(&process->mutex);
+  if (process->shutdown) {
+    state = process->running ? ATTENDANT_STATE_SHUTDOWN : ATTENDANT_STATE_DONE;
+  } else if (process->running) {
+    state = ATTENDANT_STATE_RUNNING;
+  } else if (process->tripped) {
+    state = ATTENDANT_STATE_CIRCUIT_OPEN;
+  } else if (process->dormant) {
+    state = ATTENDANT_STATE_DORMANT;
+  } else {
+    state = ATTENDANT_STATE_STARTING;
+  }
+  pthread_mutex_unlock(&process->mutex);
+
+  return state;
+}
+
+/* A `retry` with a deadline that has already passed asks for the restart, if
+ * this thread has yet to ask, but does not wait for it. */
+
+/* &#9824; */
+int attendant_request_retry(struct attendant__process *process,
+    int milliseconds) {
+  return attendant_retry_until(process, milliseconds, 0);
+}
+
+/* The monotonic clock used for the deadlines of `ready_until` and
+ * `retry_until`. */
+
+/* &#9824; */
+static long long attendant_clock() {
+  return monotonic();
+}
+
+/* Return the last error recorded by the attendant, along with the time
+ * remaining on any wait before the next start. */
+
+/* &#9824; */
+struct attendant__errors attendant_errors(struct attendant__process *process) {
+  struct attendant__errors errors;
+  long long wait;
+
+  /* After a failed initialization there is no mutex, nor any other thread. */
+  if (! process->initialized) {
+    return process->errors;
+  }
+
+  pthread_mutex_lock(&process->mutex);
+  errors = process->errors;
+  wait = process->chilled ? process->chilled - monotonic() : 0;
+  errors.wait = wait > 0 ? (int) wait : 0;
+  errors.circuit = process->tripped;
+  pthread_mutex_unlock(&process->mutex);
+
+  return errors;
+}
+
+/* &#9824; */
+struct attendant__sample attendant_sample(struct attendant__process *process) {
+  struct attendant__sample sample;
+
+  pthread_mutex_lock(&process->mutex);
+  sample = process->sample;
+  pthread_mutex_unlock(&process->mutex);
+
+  return sample;
+}
+
+/* &#9824; */
+struct attendant__usage attendant_usage(struct attendant__process *process) {
+  struct attendant__usage usage;
+
+  pthread_mutex_lock(&process->mutex);
+  usage = process->usage;
+  pthread_mutex_unlock(&process->mutex);
+
+  return usage;
+}
+
+/* The levels are read when asked for, so they are as fresh as `/proc` has
+ * them. */
+
+/* &#9824; */
+struct attendant__stress attendant_pressure(
+    struct attendant__process *process) {
+  struct attendant__stress stress;
+  char buffer[512];
+
+  pthread_mutex_lock(&process->mutex);
+  stress = process->stress;
+  pthread_mutex_unlock(&process->mutex);
+
+  if (slurp("/proc/pressure/memory", buffer, sizeof(buffer)) != -1) {
+    stress.some = level(buffer, "some");
+    stress.full = level(buffer, "full");
+  }
+  if (slurp("/proc/pressure/cpu", buffer, sizeof(buffer)) != -1) {
+    stress.cpu = level(buffer, "some");
+  }
+
+  return stress;
+}
+
+/* &#9824; */
+int attendant_snapshot(struct attendant__process *process, char *buffer,
+    int size) {
+  int length = 0;
+
+  if (size <= 0) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&process->mutex);
+  if (process->snapshot.data != NULL) {
+    length = process->snapshot.length < (size_t) size
+      ? (int) process->snapshot.length : size - 1;
+    memcpy(buffer, process->snapshot.data, length);
+  }
+  pthread_mutex_unlock(&process->mutex);
+  buffer[length] = '\0';
+
+  return length;
+}
+
+/* &#9824; */
+int attendant_tail(struct attendant__process *process, char *buffer,
+    int size) {
+  size_t length = 0, at, chunk;
+
+  if (size <= 0) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&process->mutex);
+  if (process->tail.data != NULL) {
+    length = process->tail.length < process->tail.size
+      ? process->tail.length : process->tail.size;
+    length = length < (size_t) size ? length : (size_t) size - 1;
+    at = (process->tail.length - length) % process->tail.size;
+    chunk = process->tail.size - at;
+    chunk = chunk < length ? chunk : length;
+    memcpy(buffer, process->tail.data + at, chunk);
+    memcpy(buffer + chunk, process->tail.data, length - chunk);
+  }
+  pthread_mutex_unlock(&process->mutex);
+  buffer[length] = '\0';
+
+  return (int) length;
 }
 
 /* Called when the library unloaded. This will not shutdown the server process.
@@ -1709,27 +4240,136 @@ static struct attendant__errors errors() {
  */
 
 /* &#9824; &mdash; */
-static int destroy() {
+static int destroy(struct attendant__process *process) {
+  int i;
+
+  /* A failed initialization released everything it created. */
+  if (! process->initialized) {
+    return 0;
+  }
+  process->initialized = 0;
+
+  /* Join the activator thread, which left when we shutdown. */
+  if (process->activating) {
+    pthread_join(process->activator, NULL);
+    process->activating = 0;
+  }
+
   /* Release our mutex and signaling devices. */
-  pthread_mutex_destroy(&process.mutex);
-  pthread_cond_destroy(&process.cond.running);
-  pthread_cond_destroy(&process.cond.chilling);
-  pthread_cond_destroy(&process.cond.shutdown);
-  pthread_cond_destroy(&process.cond.getgpid);
+  pthread_mutex_destroy(&process->mutex);
+  pthread_cond_destroy(&process->cond.running);
+  pthread_cond_destroy(&process->cond.chilling);
+  pthread_cond_destroy(&process->cond.shutdown);
+  pthread_cond_destroy(&process->cond.getgpid);
+
+  /* Release the thread local storage key. There are only so many. */
+  pthread_key_delete(process->key);
 
   /* Release the path to the relay program. */
-  free(process.relay);
-  process.relay = 0;
+  free(process->relay);
+  process->relay = 0;
+
+  /* Release the path to the shared plugin server process. */
+  free(process->rendezvous);
+  process->rendezvous = 0;
 
   /* Release the file descriptors reserved for the plugin stub side of the stdio
    * pipes. */
-  close(process.pipes[PIPE_STDIN][1]);
-  close(process.pipes[PIPE_STDOUT][0]);
-  close(process.pipes[PIPE_STDERR][0]);
+  close(process->pipes[PIPE_STDIN][1]);
+  close(process->pipes[PIPE_STDOUT][0]);
+  close(process->pipes[PIPE_STDERR][0]);
 
   /* Release the reaper pipe. */
-  close(process.pipes[PIPE_REAPER][0]);
-  close(process.pipes[PIPE_REAPER][1]);
+  close(process->pipes[PIPE_REAPER][0]);
+  close(process->pipes[PIPE_REAPER][1]);
+
+  /* Release the notify pipe. */
+  close(process->pipes[PIPE_NOTIFY][0]);
+  close(process->pipes[PIPE_NOTIFY][1]);
+
+  /* Release the activate pipe. */
+  close_pipe(process, PIPE_ACTIVATE, 0);
+  close_pipe(process, PIPE_ACTIVATE, 1);
+
+  /* Release the stable endpoint, and whatever we were still carrying. */
+  if (process->endpoint[0] != -1) {
+    close(process->endpoint[0]);
+    close(process->endpoint[1]);
+    process->endpoint[0] = process->endpoint[1] = -1;
+  }
+  while (process->journal.count) {
+    forget(&process->journal, 0);
+  }
+  free(process->journal.entries);
+  free(process->journal.requests.data);
+  free(process->journal.replies.data);
+  free(process->journal.outbound.data);
+  memset(&process->journal, 0, sizeof(process->journal));
+
+  /* Release the file descriptors no plugin server process will inherit. */
+  while (process->registered) {
+    close(process->registry[--process->registered].fd);
+  }
+  free(process->registry);
+  process->registry = NULL;
+
+  /* Release the warm state. The memory goes with it. */
+  if (process->warm != -1) {
+    close(process->warm);
+    process->warm = -1;
+  }
+
+  /* And the blob. */
+  if (process->blob != -1) {
+    close(process->blob);
+    process->blob = -1;
+  }
+
+  /* And the heartbeat page. */
+  if (process->heartbeat != NULL) {
+    munmap(process->heartbeat, sysconf(_SC_PAGESIZE));
+    process->heartbeat = NULL;
+  }
+  if (process->page != -1) {
+    close(process->page);
+    process->page = -1;
+  }
+
+  /* And the pressure stall triggers. */
+  for (i = 0; i < 3; i++) {
+    if (process->triggers[i] != -1) {
+      close(process->triggers[i]);
+      process->triggers[i] = -1;
+    }
+  }
+
+  /* And the hang snapshot and the tail. */
+  free(process->snapshot.data);
+  memset(&process->snapshot, 0, sizeof(process->snapshot));
+  free(process->tail.data);
+  memset(&process->tail, 0, sizeof(process->tail));
+
+  /* And the log. */
+  if (process->logbook.fd != -1) {
+    close(process->logbook.fd);
+  }
+  if (process->logbook.null != -1) {
+    close(process->logbook.null);
+  }
+  free(process->logbook.path);
+  memset(&process->logbook, 0, sizeof(process->logbook));
+  process->logbook.fd = process->logbook.null = -1;
+
+  /* Stop listening. Connections still in the backlog are refused. */
+  if (process->listener != -1) {
+    close(process->listener);
+    process->listener = -1;
+  }
+  if (process->listening) {
+    unlink(process->listening);
+    free(process->listening);
+    process->listening = NULL;
+  }
 
   say("[scram/success]");
 
@@ -1739,16 +4379,386 @@ static int destroy() {
 /* &mdash; */
 }
 
+/* ### Handles
+ *
+ * A plugin attendant of your very own. We allocate the structure zeroed, which
+ * is how we would find the default instance, and initialize it as we would the
+ * default instance.
+ */
+
+/* &#9824; */
+struct attendant__process *attendant_new(
+  struct attendant__initializer *initializer)
+{
+  struct attendant__process *process;
+  int err;
+
+  process = calloc(1, sizeof(struct attendant__process));
+  if (process == NULL) {
+    return NULL;
+  }
+  if (initalize(process, initializer) != 0) {
+    err = process->errors.system;
+    /* A failed initialization released everything it created. */
+    free(process);
+    errno = err;
+    return NULL;
+  }
+
+  return process;
+}
+
+/* &#9824; */
+int attendant_destroy(struct attendant__process *process) {
+  destroy(process);
+  free(process);
+  return 0;
+}
+
+/* ### Pools
+ *
+ * A pool is an array of plugin attendants, each with a count of the calls in
+ * flight to its plugin server process. The counts are incremented and
+ * decremented by any number of plugin stub threads, so we use atomic builtins
+ * rather than yet another mutex.
+ */
+
+/* &#9824; */
+struct attendant__pool {
+  /* The number of plugin attendants. */
+  int size;
+  /* The plugin attendants. */
+  struct attendant__process **processes;
+  /* Calls in flight for each plugin attendant. */
+  int *outstanding;
+  /* Incremented at every dispatch to pick the two choices. */
+  unsigned ticket;
+/* &mdash; */
+};
+
+#ifdef __linux__
+
+/* Parse a list of CPUs in the format the kernel uses in `sysfs`, like
+ * `0-3,8-11`, into a CPU set. Returns the number of CPUs. */
+static int parse_cpulist(const char *list, cpu_set_t *set) {
+  int first, last, cpu, count = 0;
+  char *end;
+
+  CPU_ZERO(set);
+  while (*list) {
+    first = last = (int) strtol(list, &end, 10);
+    if (end == list) {
+      break;
+    }
+    if (*end == '-') {
+      list = end + 1;
+      last = (int) strtol(list, &end, 10);
+    }
+    for (cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      CPU_SET(cpu, set);
+      count++;
+    }
+    list = *end == ',' ? end + 1 : end;
+    if (*list == '\n') {
+      break;
+    }
+  }
+
+  return count;
+}
+
+/* Pin the plugin server process in the given slot to one of the CPUs we are
+ * allowed to run on, or to all the CPUs of one of the NUMA nodes, going round
+ * robin. If the nodes cannot be found, we do not pin at all. */
+static void pin(struct attendant__process *process, int slot, int mode) {
+  char path[64], list[1024];
+  cpu_set_t allowed;
+  int cpu, count, nodes;
+  FILE *file;
+
+  if (mode == ATTENDANT_PIN_CORE) {
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1
+        || (count = CPU_COUNT(&allowed)) == 0) {
+      return;
+    }
+    count = slot % count;
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed) && count-- == 0) {
+        break;
+      }
+    }
+    CPU_ZERO(&process->affinity);
+    CPU_SET(cpu, &process->affinity);
+    process->pinned = 1;
+  } else if (mode == ATTENDANT_PIN_NODE) {
+    for (nodes = 0; ; nodes++) {
+      sprintf(path, "/sys/devices/system/node/node%d", nodes);
+      if (access(path, F_OK) == -1) {
+        break;
+      }
+    }
+    if (nodes == 0) {
+      return;
+    }
+    sprintf(path, "/sys/devices/system/node/node%d/cpulist", slot % nodes);
+    if ((file = fopen(path, "r")) == NULL) {
+      return;
+    }
+    if (fgets(list, sizeof(list), file) != NULL
+        && parse_cpulist(list, &process->affinity) != 0) {
+      process->pinned = 1;
+    }
+    fclose(file);
+  }
+}
+
+#endif
+
+/* Create a plugin attendant for each context. Each gets the initializer with
+ * its own context. */
+
+/* &#9824; */
+struct attendant__pool *attendant_pool_new(
+  struct attendant__initializer *initializer, void *contexts[], int size,
+  int pin_mode)
+{
+  struct attendant__initializer copy = *initializer;
+  struct attendant__pool *pool;
+  int i;
+
+  pool = calloc(1, sizeof(struct attendant__pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->processes = calloc(size, sizeof(struct attendant__process *));
+  pool->outstanding = calloc(size, sizeof(int));
+  if (pool->processes == NULL || pool->outstanding == NULL) {
+    goto fail;
+  }
+  for (i = 0; i < size; i++) {
+    copy.context = contexts[i];
+    if ((pool->processes[i] = attendant_new(&copy)) == NULL) {
+      goto fail;
+    }
+#ifdef __linux__
+    pin(pool->processes[i], i, pin_mode);
+#endif
+    pool->size++;
+  }
+
+  return pool;
+
+fail:
+  attendant_pool_destroy(pool);
+  return NULL;
+}
+
+/* &#9824; */
+int attendant_pool_size(struct attendant__pool *pool) {
+  return pool->size;
+}
+
+/* &#9824; */
+struct attendant__process *attendant_pool_process(struct attendant__pool *pool,
+  int slot) {
+  return pool->processes[slot];
+}
+
+/* True if the plugin server process is running and not shutting down, so that
+ * we do not dispatch to a member that is restarting. */
+static int serving(struct attendant__process *process) {
+  int serving;
+  pthread_mutex_lock(&process->mutex);
+  serving = process->running && ! process->shuttingdown;
+  pthread_mutex_unlock(&process->mutex);
+  return serving;
+}
+
+/* Pick the better of two slots. A serving member beats one that is not, then
+ * fewer calls in flight beats more. */
+static int better(struct attendant__pool *pool, int a, int b) {
+  int serving_a = serving(pool->processes[a]),
+      serving_b = serving(pool->processes[b]);
+  if (serving_a != serving_b) {
+    return serving_a ? a : b;
+  }
+  return pool->outstanding[b] < pool->outstanding[a] ? b : a;
+}
+
+/* Least outstanding looks at every member. Power of two choices looks at two
+ * members chosen at random, which is nearly as good and does not touch every
+ * mutex in the pool. We start the scan at the ticket, so that ties are spread
+ * around the pool. */
+
+/* &#9824; */
+int attendant_pool_acquire(struct attendant__pool *pool, int balance) {
+  unsigned ticket = __sync_fetch_and_add(&pool->ticket, 1);
+  int i, a, b, slot;
+
+  if (balance == ATTENDANT_BALANCE_TWO_CHOICES && pool->size > 1) {
+    a = (int) ((ticket * 2654435761u) % pool->size);
+    b = (int) (((ticket ^ 0x9e3779b9u) * 2246822519u) % pool->size);
+    if (a == b) {
+      b = (a + 1) % pool->size;
+    }
+    slot = better(pool, a, b);
+  } else {
+    slot = ticket % pool->size;
+    for (i = 1; i < pool->size; i++) {
+      slot = better(pool, slot, (ticket + i) % pool->size);
+    }
+  }
+
+  __sync_fetch_and_add(&pool->outstanding[slot], 1);
+
+  return slot;
+}
+
+/* &#9824; */
+void attendant_pool_release(struct attendant__pool *pool, int slot) {
+  __sync_fetch_and_sub(&pool->outstanding[slot], 1);
+}
+
+/* Destroy every plugin attendant. Call after each is done. */
+
+/* &#9824; */
+int attendant_pool_destroy(struct attendant__pool *pool) {
+  int i;
+  for (i = 0; i < pool->size; i++) {
+    attendant_destroy(pool->processes[i]);
+  }
+  free(pool->processes);
+  free(pool->outstanding);
+  free(pool);
+  return 0;
+}
+
+/* ### The One and Only
+ *
+ * The default instance is a static structure, and the functions of `struct
+ * attendant` call the functions above with it.
+ */
+
+/* &mdash; */
+static int initialize_singleton(struct attendant__initializer *initializer) {
+  return initalize(&singleton, initializer);
+}
+
+static int start(const char* path, char const* argv[], int wait) {
+  return attendant_start(&singleton, path, argv, wait);
+}
+
+static int start_sealed(const char* path, char const* argv[], int wait,
+  const void *blob, size_t length)
+{
+  return attendant_start_sealed(&singleton, path, argv, wait, blob, length);
+}
+
+static struct attendant__sample sample() {
+  return attendant_sample(&singleton);
+}
+
+static struct attendant__usage usage() {
+  return attendant_usage(&singleton);
+}
+
+static struct attendant__stress pressure() {
+  return attendant_pressure(&singleton);
+}
+
+static int snapshot(char *buffer, int size) {
+  return attendant_snapshot(&singleton, buffer, size);
+}
+
+static int tail(char *buffer, int size) {
+  return attendant_tail(&singleton, buffer, size);
+}
+
+static int acknowledge() {
+  return attendant_acknowledge(&singleton);
+}
+
+static int ready() {
+  return attendant_ready(&singleton);
+}
+
+static int retry(int milliseconds) {
+  return attendant_retry(&singleton, milliseconds);
+}
+
+static int shutdown_singleton() {
+  return attendant_shutdown(&singleton);
+}
+
+static int done(int timeout) {
+  return attendant_done(&singleton, timeout);
+}
+
+static int scram() {
+  return attendant_scram(&singleton);
+}
+
+static struct attendant__errors errors() {
+  return attendant_errors(&singleton);
+}
+
+static int destroy_singleton() {
+  return destroy(&singleton);
+}
+
+static int ready_until(long long deadline) {
+  return attendant_ready_until(&singleton, deadline);
+}
+
+static int retry_until(int milliseconds, long long deadline) {
+  return attendant_retry_until(&singleton, milliseconds, deadline);
+}
+
+static attendant__pipe_t notifier() {
+  return attendant_fd(&singleton);
+}
+
+static int poll_state() {
+  return attendant_poll_state(&singleton);
+}
+
+static int request_retry(int milliseconds) {
+  return attendant_request_retry(&singleton, milliseconds);
+}
+
+static attendant__pipe_t endpoint() {
+  return attendant_endpoint(&singleton);
+}
+
+static int request_shutdown() {
+  return attendant_request_shutdown(&singleton);
+}
+
 struct attendant attendant =
-{ initalize
+{ initialize_singleton
 , start
 , ready
 , retry
-, shutdown
+, shutdown_singleton
 , done
 , scram
 , errors
-, destroy
+, destroy_singleton
+, attendant_clock
+, ready_until
+, retry_until
+, notifier
+, poll_state
+, request_retry
+, request_shutdown
+, endpoint
+, start_sealed
+, sample
+, usage
+, pressure
+, snapshot
+, tail
+, acknowledge
 };
 
 /* Had a realization while considering restart. I'd initially thought that I'd
@@ -0,0 +1,71 @@
+/* The companion library, linked into a plugin server program, so that the
+ * plugin server process can talk to the plugin attendant that watches it. The
+ * plugin attendant must be initialized with a true `companion`. See
+ * **Companion Library** in `attendant.h`.
+ *
+ * The library finds its file descriptors in the environment the first time one
+ * of its functions is called. Without them, it does nothing, so a plugin server
+ * program can be run by hand.
+ */
+#ifndef ATTENDANT_SERVER_H
+#define ATTENDANT_SERVER_H
+
+#include <stdio.h>
+
+#include "attendant.h"
+
+/* The companion library functions are contained within a structure which
+ * emulates a namespace, as are the plugin attendant functions. An invocation
+ * would appear as `attendant_server.ready()` in the plugin server program. */
+
+/* */
+struct attendant_server {
+  /* `ready` &mdash; Tell the plugin attendant that we are ready to serve, so
+   * that `ready` returns in the plugin stub. Call it once, after the plugin
+   * server process can answer its first call. Returns zero on success, or -1
+   * if there is no plugin attendant to tell.
+   */
+
+  /* &#9824; */
+  int (*ready)();
+
+  /* `beat` &mdash; Increment the heartbeat, to say that we are alive. Cheap
+   * enough to call from the main loop of the plugin server process.
+   */
+
+  /* &#9824; */
+  void (*beat)();
+
+  /* `fd` &mdash; Returns the control socket, for a plugin server process with
+   * an event loop to poll. It is readable when the plugin attendant asks us to
+   * shut down, tells us of pressure, or has gone away. Call `shutdown` and
+   * `pressure` when it is readable. Returns -1 if there is no plugin
+   * attendant.
+   */
+
+  /* &#9824; */
+  int (*fd)();
+
+  /* `shutdown` &mdash; Returns true if the plugin attendant has asked us to
+   * shut down, or has gone away, in which case we should exit. Never blocks.
+   */
+
+  /* &#9824; */
+  int (*shutdown)();
+
+  /* `pressure` &mdash; Returns the pressure stall triggers that have fired
+   * since we last asked, `ATTENDANT_PRESSURE_SOME`, `ATTENDANT_PRESSURE_FULL`
+   * and `ATTENDANT_PRESSURE_CPU` or'd together, or zero if none have. A good
+   * time to drop caches. Never blocks. See **Pressure** in `attendant.h`.
+   */
+
+  /* &#9824; */
+  int (*pressure)();
+
+  /* */
+};
+
+/* The one and only companion library. */
+extern struct attendant_server attendant_server;
+
+#endif
@@ -0,0 +1,145 @@
+/* The companion library, the plugin server process side of the control socket
+ * and the heartbeat page. It is small, so that it can be linked into any
+ * plugin server program without getting in the way. It starts no threads and
+ * installs no signal handlers. */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "attendant_server.h"
+#include "eintr.h"
+
+/* Darwin has no `MSG_NOSIGNAL`. A write to a plugin attendant that has gone
+ * away would raise `SIGPIPE`, but if the plugin attendant has gone away, so
+ * has the host application, and we are done for anyway. */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* The control socket, the heartbeat page, whether we have been asked to shut
+ * down and the pressure we have been told of, which we remember, because we
+ * read the words only once. */
+static int control = -1, stopping = 0, stress = 0;
+static struct attendant__heartbeat *heartbeat;
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Find our file descriptors in the environment. */
+static void attach() {
+  const char *variable;
+  void *page;
+
+  if ((variable = getenv("ATTENDANT_CONTROL")) != NULL) {
+    control = atoi(variable);
+  }
+  if ((variable = getenv("ATTENDANT_HEARTBEAT")) != NULL) {
+    page = mmap(NULL, sizeof(struct attendant__heartbeat),
+      PROT_READ | PROT_WRITE, MAP_SHARED, atoi(variable), 0);
+    if (page != MAP_FAILED) {
+      heartbeat = page;
+    }
+  }
+}
+
+/* &mdash; */
+static int ready() {
+  int err;
+
+  pthread_once(&once, attach);
+  if (control == -1) {
+    return -1;
+  }
+  HANDLE_EINTR(send(control, "R", 1, MSG_NOSIGNAL), err);
+
+  return err == 1 ? 0 : -1;
+}
+
+/* &mdash; */
+static void beat() {
+  pthread_once(&once, attach);
+  if (heartbeat != NULL) {
+    __sync_fetch_and_add(&heartbeat->beats, 1);
+  }
+}
+
+/* &mdash; */
+static int fd() {
+  pthread_once(&once, attach);
+  return control;
+}
+
+/* Read what the plugin attendant has written. It writes an `m`, `M` or `c`
+ * when a pressure stall trigger fires, and otherwise only an `S`, so any other
+ * byte will do, and a hang up is as good as an `S`. Once we are to shut down,
+ * we read no further. Called with the mutex held. */
+static void hear() {
+  char buffer[16];
+  int err, i;
+
+  while (! stopping) {
+    HANDLE_EINTR(recv(control, buffer, sizeof(buffer), MSG_DONTWAIT), err);
+    if (err <= 0) {
+      stopping = err == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+      break;
+    }
+    for (i = 0; i < err; i++) {
+      switch (buffer[i]) {
+      case 'm':
+        stress |= ATTENDANT_PRESSURE_SOME;
+        break;
+      case 'M':
+        stress |= ATTENDANT_PRESSURE_FULL;
+        break;
+      case 'c':
+        stress |= ATTENDANT_PRESSURE_CPU;
+        break;
+      default:
+        stopping = 1;
+        break;
+      }
+    }
+  }
+}
+
+/* &mdash; */
+static int shutdown_requested() {
+  pthread_once(&once, attach);
+  if (control == -1) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&mutex);
+  hear();
+  pthread_mutex_unlock(&mutex);
+
+  return stopping;
+}
+
+/* &mdash; */
+static int pressure() {
+  int fired;
+
+  pthread_once(&once, attach);
+  if (control == -1) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&mutex);
+  hear();
+  fired = stress;
+  stress = 0;
+  pthread_mutex_unlock(&mutex);
+
+  return fired;
+}
+
+struct attendant_server attendant_server =
+{ ready
+, beat
+, fd
+, shutdown_requested
+, pressure
+};
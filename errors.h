@@ -59,4 +59,40 @@
 #define PARTIAL_STDOUT_STATUS_PIPE_NUMBER       140
 #define PARTIAL_STATUS_PIPE_NUMBER              141
 
+#define INITIALIZE_CANNOT_CREATE_NOTIFY_PIPE    142
+#define INITIALIZE_RENDEZVOUS_TOO_LONG          143
+
+#define INITIALIZE_LISTENER_TOO_LONG            144
+#define INITIALIZE_CANNOT_LISTEN                145
+#define INITIALIZE_CANARY_IS_LISTEN_FD          146
+#define RELAY_CANNOT_PASS_FD                    147
+#define INITIALIZE_CANNOT_CREATE_ACTIVATE_PIPE  148
+
+#define INITIALIZE_CANNOT_CREATE_ENDPOINT       149
+#define REAPER_CANNOT_MALLOC                    150
+
+#define INITIALIZE_CANNOT_CREATE_REGISTRY       151
+#define LAUNCH_CANNOT_CREATE_REGISTRY_SOCKET    152
+
+#define INITIALIZE_CANNOT_CREATE_WARM_STATE     153
+
+#define START_CANNOT_SEAL_BLOB                  154
+#define START_CANARY_IS_BLOB_FD                 155
+
+#define INITIALIZE_CANNOT_CREATE_HEARTBEAT      156
+#define LAUNCH_CANNOT_CREATE_CONTROL_SOCKET     157
+
+#define INITIALIZE_CANNOT_CREATE_TRIGGER        158
+
+#define INITIALIZE_CANNOT_CREATE_SNAPSHOT       159
+#define INITIALIZE_CANNOT_CREATE_TAIL           160
+
+#define INITIALIZE_CANNOT_OPEN_LOG              161
+
+#define START_NOT_INITIALIZED                   162
+
+#define INITIALIZE_TOO_MANY_INHERITED           163
+
+#define INITIALIZE_CANNOT_MALLOC                164
+
 void send_error(int pipe, int code);
@@ -16,6 +16,7 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <limits.h>
+#include <string.h>
 #include <errno.h>
 
 /* Contains error code that will be written to stderr and read by a startup
@@ -23,6 +24,12 @@
 #include "errors.h"
 #include "eintr.h"
 
+/* Linux does not define `ARG_MAX` in `limits.h` because the limit is set at
+ * runtime, so fall back to the minimum POSIX promises. */
+#ifndef ARG_MAX
+# define ARG_MAX _POSIX_ARG_MAX
+#endif
+
 /* The first argument to the program is file handle of a pipe used to report
  * errors to the library process start thread in the host application. We use
  * this extra pipe instead of STDERR or STDOUT because it will be closed on
@@ -35,6 +42,33 @@
  */
 static int spipe, pulse_pipe;
 
+/* File descriptors held by the attendant, passed along after the pulse pipe,
+ * with their names. A listening socket, then whatever the previous server
+ * process registered for its successor. We hand them to the server program
+ * starting at the first file descriptor after stdio, the way systemd does
+ * socket activation, so that a server program written for systemd needs
+ * nothing new. */
+#define PASSED_MAX 64
+
+static int passed[PASSED_MAX], passed_count;
+static char *passed_names[PASSED_MAX];
+
+/* The file descriptors on which the server program talks to the attendant,
+ * the registry socket, the control socket and the heartbeat page, each with
+ * the name of the environment variable that tells the server program where it
+ * is. We place them after those passed. */
+#define CHANNELS_MAX 8
+
+static int channels[CHANNELS_MAX], channel_count;
+static char *channel_names[CHANNELS_MAX];
+
+#define LISTEN_FDS_START 3
+
+/* The first file descriptor after those we place. */
+static int placed_end() {
+  return LISTEN_FDS_START + passed_count + channel_count;
+}
+
 /* True if a file handle is a stdio file handle. */
 int is_stdio(int fd) {
   return fd == STDIN_FILENO || fd == STDOUT_FILENO || fd == STDERR_FILENO;
@@ -91,7 +125,8 @@ void set_close_on_exec() {
   } else {
     while ((ent = readdir(dir)) != NULL) {
       fd = atoi(ent->d_name);
-      if (! is_stdio(fd) && fd != dirfd(dir) && fd != pulse_pipe) {
+      if (! is_stdio(fd) && fd != dirfd(dir) && fd != pulse_pipe
+          && (fd < LISTEN_FDS_START || fd >= placed_end())) {
         fcntl(fd, F_SETFD, FD_CLOEXEC);
       }
     }
@@ -167,16 +202,117 @@ void get_status_pipe(int argc, char *argv[]) {
    * a program to run specified by an absolute path before we go one. */
 }
 
+/* The second argument is the pulse pipe, followed by a comma separated list of
+ * the file descriptors to pass, each with a colon and its name, and the
+ * channels to the attendant, each with its variable, an at sign and its file
+ * descriptor. */
 void get_pulse_pipe(int argc, char *argv[]) {
-  char *end;
-  int err;
+  char *list, *token, *end;
   if (argc < 3) {
     send_error(spipe, RELAY_PULSE_PIPE_MISSING);
   }
-  pulse_pipe = atoi(argv[2]);
+  list = strdup(argv[2]);
+  if (list == NULL) {
+    send_error(spipe, RELAY_PULSE_PIPE_MALFORMED);
+  }
+  token = strtok(list, ",");
+  pulse_pipe = token == NULL ? 0 : atoi(token);
   if (pulse_pipe == 0) {
     send_error(spipe, RELAY_PULSE_PIPE_MALFORMED);
   }
+  while ((token = strtok(NULL, ",")) != NULL) {
+    if ((end = strchr(token, '@')) != NULL) {
+      *end = '\0';
+      channels[channel_count] = atoi(end + 1);
+      if (channel_count == CHANNELS_MAX - 1 || channels[channel_count] == 0
+          || *token == '\0') {
+        send_error(spipe, RELAY_PULSE_PIPE_MALFORMED);
+      }
+      channel_names[channel_count++] = token;
+    } else {
+      passed[passed_count] = strtol(token, &end, 10);
+      if (passed_count == PASSED_MAX - 1 || passed[passed_count] == 0
+          || *end != ':') {
+        send_error(spipe, RELAY_PULSE_PIPE_MALFORMED);
+      }
+      passed_names[passed_count++] = end + 1;
+    }
+  }
+  if (pulse_pipe >= LISTEN_FDS_START && pulse_pipe < placed_end()) {
+    send_error(spipe, RELAY_PULSE_PIPE_MALFORMED);
+  }
+}
+
+/* Move the file descriptors we pass into place and tell the server program
+ * they are there. A file descriptor we are to place might be sitting where
+ * another is to go, so we first move everything above the range, the status
+ * pipe included. It is only a number to us, and the start thread does not
+ * care where it lives. The environment is ours to change now that we have
+ * exec'd. */
+void place() {
+  char number[32], *names;
+  size_t length = 1;
+  int top = placed_end(), i, err;
+
+  if (top == LISTEN_FDS_START) {
+    return;
+  }
+
+  if (spipe >= LISTEN_FDS_START && spipe < top) {
+    spipe = fcntl(spipe, F_DUPFD, top);
+    if (spipe == -1) {
+      exit(127);
+    }
+  }
+  for (i = 0; i < passed_count; i++) {
+    passed[i] = fcntl(passed[i], F_DUPFD, top);
+    if (passed[i] == -1) {
+      send_error(spipe, RELAY_CANNOT_PASS_FD);
+    }
+  }
+  for (i = 0; i < channel_count; i++) {
+    channels[i] = fcntl(channels[i], F_DUPFD, top);
+    if (channels[i] == -1) {
+      send_error(spipe, RELAY_CANNOT_PASS_FD);
+    }
+  }
+
+  for (i = 0; i < passed_count; i++) {
+    HANDLE_EINTR(dup2(passed[i], LISTEN_FDS_START + i), err);
+    if (err == -1) {
+      send_error(spipe, RELAY_CANNOT_PASS_FD);
+    }
+    close(passed[i]);
+    length += strlen(passed_names[i]) + 1;
+  }
+  for (i = 0; i < channel_count; i++) {
+    HANDLE_EINTR(dup2(channels[i], LISTEN_FDS_START + passed_count + i), err);
+    if (err == -1) {
+      send_error(spipe, RELAY_CANNOT_PASS_FD);
+    }
+    close(channels[i]);
+    sprintf(number, "%d", LISTEN_FDS_START + passed_count + i);
+    setenv(channel_names[i], number, 1);
+  }
+
+  if (passed_count) {
+    names = malloc(length);
+    if (names == NULL) {
+      send_error(spipe, RELAY_CANNOT_PASS_FD);
+    }
+    names[0] = '\0';
+    for (i = 0; i < passed_count; i++) {
+      if (i) {
+        strcat(names, ":");
+      }
+      strcat(names, passed_names[i]);
+    }
+    sprintf(number, "%d", passed_count);
+    setenv("LISTEN_FDS", number, 1);
+    sprintf(number, "%d", getpid());
+    setenv("LISTEN_PID", number, 1);
+    setenv("LISTEN_FDNAMES", names, 1);
+  }
 }
 
 /* We check to see that we received a program name and that the path is
@@ -229,6 +365,10 @@ int main(int argc, char *argv[]) {
    * arguments are arguments for the relay program. */
   verify_arguments(argc, argv);
 
+  /* Move any file descriptors we pass to where the server program expects
+   * them. */
+  place();
+
   /* Reset signals. */
   reset_signals();
 
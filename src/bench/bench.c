@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+
+double micros() {
+  struct timespec timespec;
+  clock_gettime(CLOCK_MONOTONIC, &timespec);
+  return timespec.tv_sec * 1e6 + timespec.tv_nsec / 1e3;
+}
+
+static int compare(const void *left, const void *right) {
+  double a = *(const double*) left, b = *(const double*) right;
+  return a < b ? -1 : a > b;
+}
+
+/* Nearest rank percentile of sorted samples. */
+static double percentile(double *samples, int count, double rank) {
+  int i = (int) (rank / 100 * count + 0.5);
+  if (i < 1) i = 1;
+  if (i > count) i = count;
+  return samples[i - 1];
+}
+
+void summarize(const char *name, double *samples, int count) {
+  double sum = 0;
+  int i;
+
+  if (count == 0) {
+    printf("\"%s\":{\"count\":0}", name);
+    return;
+  }
+
+  qsort(samples, count, sizeof(double), compare);
+  for (i = 0; i < count; i++) {
+    sum += samples[i];
+  }
+
+  printf("\"%s\":{\"count\":%d,\"min\":%.1f,\"mean\":%.1f,\"p50\":%.1f,"
+    "\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}",
+    name, count, samples[0], sum / count,
+    percentile(samples, count, 50), percentile(samples, count, 90),
+    percentile(samples, count, 99), percentile(samples, count, 99.9),
+    samples[count - 1]);
+}
+
+int sizes(const char *list, long long *values, int max) {
+  char *end;
+  int count = 0;
+  while (*list && count < max) {
+    values[count] = strtoll(list, &end, 10);
+    switch (*end) {
+    case 'g': case 'G': values[count] <<= 10;
+    case 'm': case 'M': values[count] <<= 10;
+    case 'k': case 'K': values[count] <<= 10; end++;
+    }
+    count++;
+    list = *end == ',' ? end + 1 : end + strlen(end);
+  }
+  return count;
+}
@@ -0,0 +1,15 @@
+/* Timing and reporting shared by the benchmark programs. Each benchmark prints
+ * one JSON object per line, so that runs can be collected and compared by a
+ * script instead of a person. Durations are reported in microseconds. */
+
+/* Microseconds on the monotonic clock. */
+double micros();
+
+/* Append a named summary of samples to the current JSON line. The samples are
+ * sorted in place. The summary reports the count, minimum, mean, maximum and
+ * the 50th, 90th, 99th and 99.9th percentiles. */
+void summarize(const char *name, double *samples, int count);
+
+/* Parse a comma separated list of sizes into an array, accepting a `k`, `m`
+ * or `g` suffix for binary multiples. Returns the number of sizes parsed. */
+int sizes(const char *list, long long *values, int max);
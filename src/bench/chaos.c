@@ -0,0 +1,372 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../../attendant.h"
+#include "../../eintr.h"
+#include "bench.h"
+
+/* Measures recovery from faults delivered at every phase of the life cycle of
+ * the plugin server process. The tests kill the server at one convenient
+ * moment. Here we deliver a `SIGKILL` or a `SIGSTOP` to the relay or to the
+ * server at a randomized point within a chosen phase.
+ *
+ * &#9824; &nbsp; `relay` &mdash; Right after fork, before the relay handshake.
+ *
+ * &#9824; &nbsp; `handshake` &mdash; Between the reads of the status pipe
+ * number from standard out and from the status pipe.
+ *
+ * &#9824; &nbsp; `connector` &mdash; While the connector is running.
+ *
+ * &#9824; &nbsp; `drain` &mdash; While the reaper drains a chatty server.
+ *
+ * &#9824; &nbsp; `grace` &mdash; During the grace period after the reaper has
+ * sent a `SIGTERM` to a server that ignores it.
+ *
+ * The phases are found using the tracing hook, so this benchmark is built with
+ * `_SAY` defined. When a phase is reached, an injector thread waits a random
+ * number of microseconds and then delivers the signal, so the launcher and
+ * reaper threads are not held up by the injection.
+ *
+ * We measure the time from the fault to the return of `retry`. A watchdog
+ * flags any `retry` that does not return within the deadline as stuck, reports
+ * the last trace point reached, which tells us if the launcher thread is
+ * blocked on a handshake `read`, then continues and kills the faulted process
+ * to get the attendant moving again.
+ *
+ * Run from the build directory, where the relay lives.
+ *
+ *     bench/chaos [-n iterations] [-m max delay micros] [-w deadline millis]
+ *                 [-g grace millis] [-s kill|stop|both] [-r seed]
+ */
+
+#define PHASES 5
+
+static struct phase {
+  const char *name;
+  const char *trace;
+} phases[PHASES] = {
+  { "relay", "[launch/relay] %d" },
+  { "handshake", "[launch/handshake]" },
+  { "connector", "[launch/connect]" },
+  { "drain", "[reap/poll]" },
+  { "grace", "[reap/kill] %d" }
+};
+
+static char path[PATH_MAX];
+
+/* Guards everything below. */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+/* The pid of the relay, which becomes the pid of the server. */
+static pid_t pid;
+
+/* Standard input of the server, which we write to when it is time to exit. */
+static attendant__pipe_t in;
+
+/* The last trace point reached. */
+static const char *last = "";
+
+/* The fault we're waiting to deliver. The phase is `-1` when disarmed. */
+static struct fault {
+  int phase;
+  int signal;
+  int delay;
+  int pending;
+  int fired;
+  pid_t target;
+  double at;
+} fault = { -1 };
+
+/* When the main thread entered `retry`, or zero if it is not waiting, and
+ * the number of times the watchdog found it stuck in this iteration. */
+static double waiting;
+static int stuck;
+
+/* The phase and signal of the current iteration, for the watchdog. */
+static int current, signaled;
+
+static int deadline = 1000;
+
+void say(const char *format, ...) {
+  va_list args;
+  int arg = 0;
+
+  /* Only the trace points we act on are known to pass an `int`. */
+  va_start(args, format);
+  if (strcmp(format, "[launch/relay] %d") == 0
+      || strcmp(format, "[reap/kill] %d") == 0) {
+    arg = va_arg(args, int);
+  }
+  va_end(args);
+
+  pthread_mutex_lock(&mutex);
+  last = format;
+  if (strcmp(format, "[launch/relay] %d") == 0) {
+    pid = arg;
+  }
+  if (fault.phase != -1 && strcmp(format, phases[fault.phase].trace) == 0
+      && (strcmp(format, "[reap/kill] %d") != 0 || arg == SIGTERM)) {
+    fault.phase = -1;
+    fault.pending = 1;
+    fault.target = pid;
+    pthread_cond_broadcast(&cond);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+static void starter(int restart, int uptime) {
+  char const *argv[] = { "stubborn", "chatty", NULL };
+  attendant.start(path, argv, 0);
+}
+
+/* Take the pid line so the stdout is left to the reaper to drain. We get the
+ * pid from the trace, so we do not care if the read fails. */
+static void connector(attendant__pipe_t to, attendant__pipe_t from) {
+  char ch;
+  int err;
+  in = to;
+  do {
+    HANDLE_EINTR(read(from, &ch, 1), err);
+  } while (err == 1 && ch != '\n');
+}
+
+/* Deliver faults after a delay, off of the attendant's threads. */
+static void* injector(void *data) {
+  struct fault copy;
+  pthread_mutex_lock(&mutex);
+  for (;;) {
+    while (! fault.pending) {
+      pthread_cond_wait(&cond, &mutex);
+    }
+    fault.pending = 0;
+    copy = fault;
+    pthread_mutex_unlock(&mutex);
+    usleep(copy.delay);
+    pthread_mutex_lock(&mutex);
+    if (copy.target > 0) {
+      kill(copy.target, copy.signal);
+    }
+    fault.at = micros();
+    fault.fired = 1;
+    pthread_cond_broadcast(&cond);
+  }
+  return NULL;
+}
+
+static const char *signame(int sig) {
+  return sig == SIGKILL ? "SIGKILL" : "SIGSTOP";
+}
+
+/* Flag a `retry` that has not returned by the deadline, and get things moving
+ * again by killing the faulted process. If we are still stuck after that, the
+ * attendant is wedged and there is no point in going on. */
+static void* watchdog(void *data) {
+  for (;;) {
+    usleep(10000);
+    pthread_mutex_lock(&mutex);
+    if (waiting && micros() - waiting > deadline * 1000.0) {
+      printf("{\"bench\":\"chaos\",\"stuck\":\"%s\",\"signal\":\"%s\","
+        "\"last\":\"%s\",\"launch_blocked\":%s}\n",
+        phases[current].name, signame(signaled), last,
+        strcmp(last, "[launch/relay] %d") == 0
+        || strcmp(last, "[launch/handshake]") == 0 ? "true" : "false");
+      fflush(stdout);
+      if (stuck++) {
+        exit(EXIT_FAILURE);
+      }
+      waiting = micros();
+      if (fault.target > 0) {
+        kill(fault.target, SIGCONT);
+        kill(fault.target, SIGKILL);
+      }
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+  return NULL;
+}
+
+/* Call `retry` under the eye of the watchdog. */
+static int watched(int millis) {
+  int ok;
+  pthread_mutex_lock(&mutex);
+  waiting = micros();
+  pthread_mutex_unlock(&mutex);
+  ok = attendant.retry(millis);
+  pthread_mutex_lock(&mutex);
+  waiting = 0;
+  pthread_mutex_unlock(&mutex);
+  return ok;
+}
+
+/* Wait for the injector to fire, up to the deadline. */
+static int fired() {
+  double begin = micros();
+  int fired;
+  for (;;) {
+    pthread_mutex_lock(&mutex);
+    fired = fault.fired;
+    pthread_mutex_unlock(&mutex);
+    if (fired || micros() - begin > deadline * 1000.0) {
+      return fired;
+    }
+    usleep(100);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  struct attendant__initializer initializer;
+  pthread_t thread;
+  double *recovery[PHASES][2], end, at;
+  int runs[PHASES][2], missed[PHASES][2], wedged[PHASES][2];
+  int iterations = 1000, delay = 2000, grace = 100, signals = 3;
+  int opt, i, phase, sig, err;
+  unsigned seed = (unsigned) time(NULL);
+  char ch = '\n';
+
+  while ((opt = getopt(argc, argv, "n:m:w:g:s:r:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = atoi(optarg);
+      break;
+    case 'm':
+      delay = atoi(optarg);
+      break;
+    case 'w':
+      deadline = atoi(optarg);
+      break;
+    case 'g':
+      grace = atoi(optarg);
+      break;
+    case 's':
+      signals = strcmp(optarg, "kill") == 0 ? 1
+              : strcmp(optarg, "stop") == 0 ? 2 : 3;
+      break;
+    case 'r':
+      seed = (unsigned) atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n iterations] [-m max delay micros] "
+        "[-w deadline millis] [-g grace millis] [-s kill|stop|both] "
+        "[-r seed]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  srand(seed);
+
+  memset(runs, 0, sizeof(runs));
+  memset(missed, 0, sizeof(missed));
+  memset(wedged, 0, sizeof(wedged));
+  for (phase = 0; phase < PHASES; phase++) {
+    for (sig = 0; sig < 2; sig++) {
+      recovery[phase][sig] = malloc(sizeof(double) * iterations);
+    }
+  }
+
+  memset(&initializer, 0, sizeof(initializer));
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  strcat(getcwd(path, PATH_MAX), "/bench/bin/server");
+
+  pthread_create(&thread, NULL, injector, NULL);
+  pthread_create(&thread, NULL, watchdog, NULL);
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+  if (! attendant.ready()) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < iterations; i++) {
+    phase = rand() % PHASES;
+    sig = signals == 3 ? rand() % 2 : signals - 1;
+
+    pthread_mutex_lock(&mutex);
+    current = phase;
+    signaled = sig ? SIGSTOP : SIGKILL;
+    stuck = 0;
+    fault.phase = phase;
+    fault.signal = signaled;
+    fault.delay = delay ? rand() % delay : 0;
+    fault.fired = 0;
+    fault.target = 0;
+    pthread_mutex_unlock(&mutex);
+
+    /* The launch phases need a launch, so kill the running server. The drain
+     * phase needs only a running server. The grace phase is reached through
+     * `retry` itself. */
+    if (phase == 3) {
+      fired();
+    } else if (phase != 4) {
+      pthread_mutex_lock(&mutex);
+      kill(pid, SIGKILL);
+      pthread_mutex_unlock(&mutex);
+    }
+
+    watched(phase == 4 ? grace : 0);
+    end = micros();
+
+    /* A phase we never reached is a miss. */
+    if (! fired()) {
+      pthread_mutex_lock(&mutex);
+      fault.phase = -1;
+      pthread_mutex_unlock(&mutex);
+      missed[phase][sig]++;
+      continue;
+    }
+
+    /* The injector wrote when it fired under the mutex. */
+    pthread_mutex_lock(&mutex);
+    at = fault.at;
+    pthread_mutex_unlock(&mutex);
+
+    /* If the fault landed after recovery, recover again. */
+    if (at > end) {
+      watched(0);
+      end = micros();
+    }
+
+    recovery[phase][sig][runs[phase][sig]] = end - at;
+    runs[phase][sig]++;
+    pthread_mutex_lock(&mutex);
+    if (stuck) {
+      wedged[phase][sig]++;
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(in, &ch, sizeof(ch)), err);
+  attendant.done(-1);
+  attendant.destroy();
+
+  for (phase = 0; phase < PHASES; phase++) {
+    for (sig = 0; sig < 2; sig++) {
+      if (runs[phase][sig] + missed[phase][sig] == 0) {
+        continue;
+      }
+      printf("{\"bench\":\"chaos\",\"phase\":\"%s\",\"signal\":\"%s\","
+        "\"runs\":%d,\"missed\":%d,\"stuck\":%d,", phases[phase].name,
+        signame(sig ? SIGSTOP : SIGKILL), runs[phase][sig],
+        missed[phase][sig], wedged[phase][sig]);
+      summarize("recovery", recovery[phase][sig], runs[phase][sig]);
+      printf("}\n");
+    }
+  }
+  printf("{\"bench\":\"chaos\",\"seed\":%u,\"iterations\":%d}\n", seed,
+    iterations);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "../../attendant.h"
+#include "../../eintr.h"
+#include "bench.h"
+
+/* Measures the plugin stub functions under contention. A crowd of plugin stub
+ * threads hammer `ready` while the server runs, which exercises the process
+ * mutex. Then we kill the server and release the whole crowd into `retry` at
+ * once, which exercises the thread local instance numbers that are supposed to
+ * ensure that only one thread asks the reaper for a restart, and the running
+ * condition that releases the crowd when the replacement is up.
+ *
+ * We count the threads that wrote to the reaper pipe using the tracing hook,
+ * so this benchmark is built with `_SAY` defined. We expect at most one write
+ * per round, none if the reaper noticed the exit before the crowd did. More
+ * than one means that the instance numbers are not doing their job.
+ *
+ * Run from the build directory, where the relay lives.
+ *
+ *     bench/contention [-t threads,...] [-d millis] [-n rounds]
+ */
+
+#define MAX_SIZES 32
+#define MAX_SAMPLES 8192
+
+static char path[PATH_MAX];
+static pid_t pid;
+static attendant__pipe_t in;
+
+/* Guards the phase of the benchmark and the count of threads that have
+ * finished the current phase. */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int phase, arrived;
+
+/* Set by the main thread to end the steady state. */
+static volatile int stop;
+
+/* Count of calls to `retry` that sent an instance number to the reaper. */
+static int terminates;
+
+struct crowd {
+  pthread_t thread;
+  int rounds;
+  long calls;
+  double ready[MAX_SAMPLES];
+  double *retry;
+  double *released;
+};
+
+void say(const char *format, ...) {
+  if (strcmp(format, "[retry/terminate]") == 0) {
+    pthread_mutex_lock(&mutex);
+    terminates++;
+    pthread_mutex_unlock(&mutex);
+  }
+}
+
+static void starter(int restart, int uptime) {
+  char const *argv[] = { NULL };
+  attendant.start(path, argv, 0);
+}
+
+static void connector(attendant__pipe_t to, attendant__pipe_t from) {
+  char line[32];
+  int i = 0, err;
+
+  in = to;
+
+  do {
+    HANDLE_EINTR(read(from, &line[i], 1), err);
+  } while (err == 1 && line[i] != '\n' && ++i < sizeof(line) - 1);
+  line[i] = '\0';
+
+  pid = atoi(line);
+}
+
+/* Wait for the main thread to open the given phase. */
+static void gate(int which) {
+  pthread_mutex_lock(&mutex);
+  while (phase < which) {
+    pthread_cond_wait(&cond, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Tell the main thread that we are done with a phase. */
+static void arrive() {
+  pthread_mutex_lock(&mutex);
+  arrived++;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+static void* hammer(void *data) {
+  struct crowd *crowd = (struct crowd*) data;
+  double begin;
+  int round;
+
+  gate(1);
+  while (! stop) {
+    begin = micros();
+    attendant.ready();
+    crowd->ready[crowd->calls++ % MAX_SAMPLES] = micros() - begin;
+  }
+  arrive();
+
+  for (round = 0; round < crowd->rounds; round++) {
+    gate(round + 2);
+    begin = micros();
+    attendant.retry(0);
+    crowd->released[round] = micros();
+    crowd->retry[round] = crowd->released[round] - begin;
+    arrive();
+  }
+
+  return NULL;
+}
+
+/* Wait for all of the threads to arrive at the end of a phase. */
+static void gather(int count) {
+  pthread_mutex_lock(&mutex);
+  while (arrived < count) {
+    pthread_cond_wait(&cond, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+/* Open a phase. */
+static void open_phase(int which) {
+  pthread_mutex_lock(&mutex);
+  phase = which;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+static void measure(int threads, int millis, int rounds) {
+  struct attendant__initializer initializer;
+  struct crowd *crowd;
+  double *ready, *retry, *release, begin, elapsed, killed, last;
+  long calls = 0, samples = 0, n;
+  int i, round, err;
+  char ch = '\n';
+
+  crowd = calloc(threads, sizeof(struct crowd));
+  ready = malloc(sizeof(double) * threads * MAX_SAMPLES);
+  retry = malloc(sizeof(double) * threads * rounds);
+  release = malloc(sizeof(double) * rounds);
+  if (!crowd || !ready || !retry || !release) {
+    exit(EXIT_FAILURE);
+  }
+
+  memset(&initializer, 0, sizeof(initializer));
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  strcat(getcwd(path, PATH_MAX), "/bench/bin/server");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+  if (! attendant.ready()) {
+    exit(EXIT_FAILURE);
+  }
+
+  for (i = 0; i < threads; i++) {
+    crowd[i].rounds = rounds;
+    crowd[i].retry = malloc(sizeof(double) * rounds);
+    crowd[i].released = malloc(sizeof(double) * rounds);
+    pthread_create(&crowd[i].thread, NULL, hammer, &crowd[i]);
+  }
+
+  /* Steady state, the server is running and everyone calls `ready`. */
+  begin = micros();
+  open_phase(1);
+  usleep(millis * 1000);
+  stop = 1;
+  gather(threads);
+  elapsed = micros() - begin;
+
+  /* Kill the server and release the crowd into `retry` all at once. */
+  for (round = 0; round < rounds; round++) {
+    killed = micros();
+    kill(pid, SIGKILL);
+    open_phase(round + 2);
+    gather(threads * (round + 2));
+    last = 0;
+    for (i = 0; i < threads; i++) {
+      if (crowd[i].released[round] > last) {
+        last = crowd[i].released[round];
+      }
+    }
+    release[round] = last - killed;
+  }
+
+  for (i = 0; i < threads; i++) {
+    pthread_join(crowd[i].thread, NULL);
+    calls += crowd[i].calls;
+    n = crowd[i].calls < MAX_SAMPLES ? crowd[i].calls : MAX_SAMPLES;
+    memcpy(ready + samples, crowd[i].ready, sizeof(double) * n);
+    samples += n;
+    memcpy(retry + i * rounds, crowd[i].retry, sizeof(double) * rounds);
+  }
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(in, &ch, sizeof(ch)), err);
+  attendant.done(-1);
+  attendant.destroy();
+
+  printf("{\"bench\":\"contention\",\"threads\":%d,\"calls\":%ld,"
+    "\"per_second\":%.0f,", threads, calls, calls / (elapsed / 1e6));
+  summarize("ready", ready, samples);
+  printf(",\"rounds\":%d,\"terminates\":%d,", rounds, terminates);
+  summarize("retry", retry, threads * rounds);
+  printf(",");
+  summarize("last_released", release, rounds);
+  printf("}\n");
+  fflush(stdout);
+}
+
+static void run(int threads, int millis, int rounds) {
+  pid_t child;
+  int status, err;
+
+  child = fork();
+  if (child == 0) {
+    measure(threads, millis, rounds);
+    exit(EXIT_SUCCESS);
+  }
+  HANDLE_EINTR(waitpid(child, &status, 0), err);
+  if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    printf("{\"bench\":\"contention\",\"threads\":%d,\"failed\":%d}\n",
+      threads, status);
+    fflush(stdout);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long long threads[MAX_SIZES];
+  int nthreads, millis = 1000, rounds = 10, opt, i;
+
+  nthreads = sizes("1,2,4,8,16,32,64,128,256", threads, MAX_SIZES);
+
+  while ((opt = getopt(argc, argv, "t:d:n:")) != -1) {
+    switch (opt) {
+    case 't':
+      nthreads = sizes(optarg, threads, MAX_SIZES);
+      break;
+    case 'd':
+      millis = atoi(optarg);
+      break;
+    case 'n':
+      rounds = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-t threads,...] [-d millis] [-n rounds]\n",
+        argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  for (i = 0; i < nthreads; i++) {
+    run((int) threads[i], millis, rounds);
+  }
+
+  return EXIT_SUCCESS;
+}
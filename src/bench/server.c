@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
+
+/* This is a benchmark server. It is ready the moment it runs. It reports its
+ * pid on standard out, so that a benchmark can kill it, and it exits on any
+ * input on standard in, or when standard in closes.
+ *
+ * Given `stubborn` it ignores `SIGTERM`, so that the attendant has to wait out
+ * the grace period and escalate to `SIGKILL`. Given `chatty` it writes to
+ * standard out continuously, so that the reaper is always draining. */
+int main(int argc, char *argv[]) {
+  struct pollfd pollfd;
+  char chatter[1024];
+  int chatty = 0, i, err;
+
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "stubborn") == 0) {
+      signal(SIGTERM, SIG_IGN);
+    } else if (strcmp(argv[i], "chatty") == 0) {
+      chatty = 1;
+    }
+  }
+
+  printf("%d\n", (int) getpid());
+  fflush(stdout);
+
+  memset(chatter, '.', sizeof(chatter));
+  chatter[sizeof(chatter) - 1] = '\n';
+
+  pollfd.fd = STDIN_FILENO;
+  pollfd.events = POLLIN;
+  for (;;) {
+    err = poll(&pollfd, 1, chatty ? 1 : -1);
+    if (err == 1) {
+      break;
+    }
+    if (chatty) {
+      while (write(STDOUT_FILENO, chatter, sizeof(chatter)) == -1
+          && errno == EINTR);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,267 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+
+#include "../../attendant.h"
+#include "../../eintr.h"
+#include "bench.h"
+
+/* Soaks the attendant in restarts. A host application keeps a plugin loaded
+ * for weeks, and the server may restart thousands of times in that span, so a
+ * leak of a single file descriptor, a thread, a zombie or a few bytes per
+ * restart in `start`, `launch`, `free_argv` or `close_pipes` will add up.
+ *
+ * We kill the server with `SIGKILL` and wait on `retry` for the replacement as
+ * fast as the attendant will go. Every so many restarts we sample the host
+ * application from `/proc`. We count the entries in `/proc/self/fd`, read the
+ * resident set from `/proc/self/statm` and the thread count from
+ * `/proc/self/status`, and count the zombie children by scanning `/proc`.
+ *
+ * The first sample, taken after a warm up, is the baseline. When `retry`
+ * returns the reaper is running and the launcher has been joined, so the file
+ * descriptor, thread and zombie counts must never move from the baseline. The
+ * resident set may wander by a little as the allocator settles, so it gets a
+ * slack, by default one megabyte. We exit non-zero if anything grows.
+ *
+ * We report the restart rate for each sampling interval and for the entire
+ * run, which is the maximum restart rate the attendant can sustain.
+ *
+ * Linux only, because of `/proc`. Run from the build directory, where the
+ * relay lives.
+ *
+ *     bench/soak [-n restarts] [-i interval] [-w warm up] [-s rss slack]
+ */
+
+static char path[PATH_MAX];
+static pid_t pid;
+static attendant__pipe_t in;
+
+struct sample {
+  long fds;
+  long long rss;
+  long threads;
+  long zombies;
+};
+
+static void starter(int restart, int uptime) {
+  char const *argv[] = { NULL };
+  attendant.start(path, argv, 0);
+}
+
+static void connector(attendant__pipe_t to, attendant__pipe_t from) {
+  char line[32];
+  int i = 0, err;
+
+  in = to;
+
+  do {
+    HANDLE_EINTR(read(from, &line[i], 1), err);
+  } while (err == 1 && line[i] != '\n' && ++i < sizeof(line) - 1);
+  line[i] = '\0';
+
+  pid = atoi(line);
+}
+
+/* Count the open file descriptors, not counting the one used to count. */
+static long fds() {
+  struct dirent *entry;
+  DIR *dir;
+  long count = 0;
+
+  if ((dir = opendir("/proc/self/fd")) == NULL) {
+    return -1;
+  }
+  while ((entry = readdir(dir)) != NULL) {
+    if (isdigit(entry->d_name[0])) {
+      count++;
+    }
+  }
+  closedir(dir);
+
+  return count - 1;
+}
+
+static long long rss() {
+  FILE *file;
+  long long size, resident = -1;
+
+  if ((file = fopen("/proc/self/statm", "r")) != NULL) {
+    if (fscanf(file, "%lld %lld", &size, &resident) == 2) {
+      resident *= sysconf(_SC_PAGESIZE);
+    }
+    fclose(file);
+  }
+
+  return resident;
+}
+
+static long threads() {
+  FILE *file;
+  char line[256];
+  long count = -1;
+
+  if ((file = fopen("/proc/self/status", "r")) != NULL) {
+    while (fgets(line, sizeof(line), file)) {
+      if (sscanf(line, "Threads: %ld", &count) == 1) {
+        break;
+      }
+    }
+    fclose(file);
+  }
+
+  return count;
+}
+
+/* Scan the process table for our children that have exited and have not been
+ * reaped. The command name in `stat` is in parenthesis and may itself contain
+ * spaces or parenthesis, so we parse from the last closing parenthesis. */
+static long zombies() {
+  struct dirent *entry;
+  DIR *dir;
+  FILE *file;
+  char name[300], line[512], *paren, state;
+  long count = 0;
+  int parent;
+
+  if ((dir = opendir("/proc")) == NULL) {
+    return -1;
+  }
+  while ((entry = readdir(dir)) != NULL) {
+    if (! isdigit(entry->d_name[0])) {
+      continue;
+    }
+    snprintf(name, sizeof(name), "/proc/%s/stat", entry->d_name);
+    if ((file = fopen(name, "r")) == NULL) {
+      continue;
+    }
+    if (fgets(line, sizeof(line), file) && (paren = strrchr(line, ')'))
+        && sscanf(paren + 1, " %c %d", &state, &parent) == 2
+        && parent == getpid() && state == 'Z') {
+      count++;
+    }
+    fclose(file);
+  }
+  closedir(dir);
+
+  return count;
+}
+
+static void sample(struct sample *sample) {
+  sample->fds = fds();
+  sample->rss = rss();
+  sample->threads = threads();
+  sample->zombies = zombies();
+}
+
+int main(int argc, char *argv[]) {
+  struct attendant__initializer initializer;
+  struct sample baseline, current;
+  double *rates, begin, mark, now;
+  long long slack = 1024 * 1024;
+  long restarts = 100000, interval = 1000, warmup = 1000, i, intervals = 0;
+  int leaked = 0, opt, err;
+  char ch = '\n';
+
+  while ((opt = getopt(argc, argv, "n:i:w:s:")) != -1) {
+    switch (opt) {
+    case 'n':
+      restarts = atol(optarg);
+      break;
+    case 'i':
+      interval = atol(optarg);
+      break;
+    case 'w':
+      warmup = atol(optarg);
+      break;
+    case 's':
+      sizes(optarg, &slack, 1);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n restarts] [-i interval] [-w warm up] "
+        "[-s rss slack]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (interval < 1) {
+    interval = 1;
+  }
+
+  rates = malloc(sizeof(double) * (restarts / interval + 1));
+  if (rates == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  memset(&initializer, 0, sizeof(initializer));
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  strcat(getcwd(path, PATH_MAX), "/bench/bin/server");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+  if (! attendant.ready()) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < warmup; i++) {
+    kill(pid, SIGKILL);
+    if (! attendant.retry(0)) {
+      return EXIT_FAILURE;
+    }
+  }
+  sample(&baseline);
+  current = baseline;
+
+  begin = mark = micros();
+  for (i = 1; i <= restarts; i++) {
+    kill(pid, SIGKILL);
+    if (! attendant.retry(0)) {
+      printf("{\"bench\":\"soak\",\"restarts\":%ld,\"error\":%d,"
+        "\"errno\":%d}\n", i, attendant.errors().attendant,
+        attendant.errors().system);
+      return EXIT_FAILURE;
+    }
+    if (i % interval == 0 || i == restarts) {
+      now = micros();
+      rates[intervals++] = (i % interval ? i % interval : interval)
+                         / ((now - mark) / 1e6);
+      sample(&current);
+      printf("{\"bench\":\"soak\",\"restarts\":%ld,\"fds\":%ld,\"rss\":%lld,"
+        "\"threads\":%ld,\"zombies\":%ld,\"per_second\":%.0f}\n", i,
+        current.fds, current.rss, current.threads, current.zombies,
+        rates[intervals - 1]);
+      fflush(stdout);
+      if (current.fds > baseline.fds || current.threads > baseline.threads
+          || current.zombies > baseline.zombies
+          || current.rss > baseline.rss + slack) {
+        leaked = 1;
+      }
+      mark = micros();
+    }
+  }
+  now = micros();
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(in, &ch, sizeof(ch)), err);
+  attendant.done(-1);
+  attendant.destroy();
+
+  printf("{\"bench\":\"soak\",\"baseline\":{\"fds\":%ld,\"rss\":%lld,"
+    "\"threads\":%ld,\"zombies\":%ld},\"final\":{\"fds\":%ld,\"rss\":%lld,"
+    "\"threads\":%ld,\"zombies\":%ld},\"restarts\":%ld,\"per_second\":%.0f,",
+    baseline.fds, baseline.rss, baseline.threads, baseline.zombies,
+    current.fds, current.rss, current.threads, current.zombies, restarts,
+    restarts / ((now - begin) / 1e6));
+  summarize("interval_per_second", rates, intervals);
+  printf(",\"leaked\":%s}\n", leaked ? "true" : "false");
+
+  return leaked ? EXIT_FAILURE : EXIT_SUCCESS;
+}
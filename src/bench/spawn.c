@@ -0,0 +1,249 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "../../attendant.h"
+#include "../../eintr.h"
+#include "bench.h"
+
+/* Measures what a restart costs the host application. We time the cold start,
+ * from the call to `start` to the return of `ready`, and then we repeatedly
+ * kill the server with `SIGKILL` and time the call to `retry` that waits for
+ * the replacement. The server used is ready the moment it runs, so we are
+ * measuring the attendant, the fork of the host and the relay, not the server.
+ *
+ * The cost of a fork grows with the host application, so we sweep the size of
+ * the host, one factor at a time. We balloon the resident set, we park idle
+ * threads, and we fill the file descriptor table, which the relay must walk.
+ * Each configuration runs in a freshly forked process, because the attendant
+ * only ever runs once per process.
+ *
+ * Run from the build directory, where the relay lives.
+ *
+ *     bench/spawn [-n iterations] [-r rss,...] [-t threads,...] [-f fds,...]
+ *
+ * Sizes accept a `k`, `m` or `g` suffix. Sizes of resident memory larger than
+ * three quarters of physical memory are reported as skipped. */
+
+#define MAX_SIZES 32
+
+static char path[PATH_MAX];
+
+/* Time of the last call to start, set by the starter in the reaper thread. */
+static double started;
+
+/* The server process, reported by the server through standard out, and the
+ * standard input we write to when it is time for it to exit. */
+static pid_t pid;
+static attendant__pipe_t in;
+
+static void starter(int restart, int uptime) {
+  char const *argv[] = { NULL };
+  started = micros();
+  attendant.start(path, argv, 0);
+}
+
+static void connector(attendant__pipe_t to, attendant__pipe_t from) {
+  char line[32];
+  int i = 0, err;
+
+  in = to;
+
+  /* Read a byte at a time, so we take only the line with the pid. */
+  do {
+    HANDLE_EINTR(read(from, &line[i], 1), err);
+  } while (err == 1 && line[i] != '\n' && ++i < sizeof(line) - 1);
+  line[i] = '\0';
+
+  pid = atoi(line);
+}
+
+/* Parked threads that do nothing but exist when the host forks. */
+static void* idle(void *data) {
+  for (;;) pause();
+  return NULL;
+}
+
+/* Grow the host application. Returns the number of file descriptors we were
+ * actually able to open. */
+static long long grow(long long rss, long long threads, long long fds) {
+  struct rlimit limit;
+  pthread_attr_t attr;
+  pthread_t thread;
+  long long i;
+  long page = sysconf(_SC_PAGESIZE);
+  char *balloon;
+
+  if (rss) {
+    balloon = malloc(rss);
+    if (balloon == NULL) {
+      return -1;
+    }
+    for (i = 0; i < rss; i += page) {
+      balloon[i] = 1;
+    }
+  }
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, 64 * 1024);
+  for (i = 0; i < threads; i++) {
+    if (pthread_create(&thread, &attr, idle, NULL) != 0) {
+      break;
+    }
+  }
+  pthread_attr_destroy(&attr);
+
+  getrlimit(RLIMIT_NOFILE, &limit);
+  if (limit.rlim_cur < fds + 64) {
+    limit.rlim_cur = fds + 64 < limit.rlim_max ? fds + 64 : limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  for (i = 0; i < fds; i++) {
+    if (open("/dev/null", O_RDONLY) == -1) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+static void measure(long long rss, long long threads, long long fds,
+    int iterations) {
+  struct attendant__initializer initializer;
+  double *ready, *retry, killed, stop;
+  int i, err;
+  char ch = '\n';
+
+  ready = malloc(sizeof(double) * (iterations + 1));
+  retry = malloc(sizeof(double) * iterations);
+  if (ready == NULL || retry == NULL) {
+    exit(EXIT_FAILURE);
+  }
+
+  if ((fds = grow(rss, threads, fds)) == -1) {
+    printf("{\"bench\":\"spawn\",\"rss\":%lld,\"skipped\":\"malloc\"}\n", rss);
+    exit(EXIT_SUCCESS);
+  }
+
+  memset(&initializer, 0, sizeof(initializer));
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  strcat(getcwd(path, PATH_MAX), "/bench/bin/server");
+
+  attendant.initialize(&initializer);
+
+  starter(0, 0);
+  if (! attendant.ready()) {
+    printf("{\"bench\":\"spawn\",\"error\":%d,\"errno\":%d}\n",
+      attendant.errors().attendant, attendant.errors().system);
+    exit(EXIT_FAILURE);
+  }
+  ready[0] = micros() - started;
+
+  for (i = 0; i < iterations; i++) {
+    killed = micros();
+    kill(pid, SIGKILL);
+    if (! attendant.retry(0)) {
+      break;
+    }
+    stop = micros();
+    retry[i] = stop - killed;
+    ready[i + 1] = stop - started;
+  }
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(in, &ch, sizeof(ch)), err);
+  attendant.done(-1);
+  attendant.destroy();
+
+  printf("{\"bench\":\"spawn\",\"rss\":%lld,\"threads\":%lld,\"fds\":%lld,",
+    rss, threads, fds);
+  summarize("start_ready", ready, i + 1);
+  printf(",");
+  summarize("kill_retry", retry, i);
+  printf("}\n");
+  fflush(stdout);
+}
+
+/* Run a configuration in a child process, so that each configuration gets a
+ * pristine host application and a pristine attendant. */
+static void run(long long rss, long long threads, long long fds,
+    int iterations) {
+  long long physical = (long long) sysconf(_SC_PHYS_PAGES)
+                     * sysconf(_SC_PAGESIZE);
+  pid_t child;
+  int status, err;
+
+  if (rss > physical / 4 * 3) {
+    printf("{\"bench\":\"spawn\",\"rss\":%lld,\"skipped\":\"physical\"}\n", rss);
+    fflush(stdout);
+    return;
+  }
+
+  child = fork();
+  if (child == 0) {
+    measure(rss, threads, fds, iterations);
+    exit(EXIT_SUCCESS);
+  }
+  HANDLE_EINTR(waitpid(child, &status, 0), err);
+  if (! WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    printf("{\"bench\":\"spawn\",\"rss\":%lld,\"threads\":%lld,\"fds\":%lld,"
+      "\"failed\":%d}\n", rss, threads, fds, status);
+    fflush(stdout);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long long rss[MAX_SIZES], threads[MAX_SIZES], fds[MAX_SIZES];
+  int nrss, nthreads, nfds, iterations = 100, opt, i;
+
+  nrss = sizes("0,1g,2g,4g,8g,16g,32g", rss, MAX_SIZES);
+  nthreads = sizes("0,16,64,256,1024", threads, MAX_SIZES);
+  nfds = sizes("0,1k,16k,64k", fds, MAX_SIZES);
+
+  while ((opt = getopt(argc, argv, "n:r:t:f:")) != -1) {
+    switch (opt) {
+    case 'n':
+      iterations = atoi(optarg);
+      break;
+    case 'r':
+      nrss = sizes(optarg, rss, MAX_SIZES);
+      break;
+    case 't':
+      nthreads = sizes(optarg, threads, MAX_SIZES);
+      break;
+    case 'f':
+      nfds = sizes(optarg, fds, MAX_SIZES);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-n iterations] [-r rss,...] "
+        "[-t threads,...] [-f fds,...]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  /* A baseline, then one factor at a time. */
+  run(0, 0, 0, iterations);
+  for (i = 0; i < nrss; i++) {
+    if (rss[i]) run(rss[i], 0, 0, iterations);
+  }
+  for (i = 0; i < nthreads; i++) {
+    if (threads[i]) run(0, threads[i], 0, iterations);
+  }
+  for (i = 0; i < nfds; i++) {
+    if (fds[i]) run(0, 0, fds[i], iterations);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+/* This is a testing server for socket activation. It accepts connections on
+ * the socket passed at file descriptor 3 and greets each one, saying whether
+ * `LISTEN_FDS` and `LISTEN_PID` were set as systemd would set them. It exits
+ * on any input on standard input, or when standard input hangs up. */
+int main() {
+  struct pollfd fds[2];
+  const char *count = getenv("LISTEN_FDS"), *pid = getenv("LISTEN_PID");
+  const char *greeting = "HELLO\n";
+  int fd, err;
+
+  if (count == NULL || strcmp(count, "1") != 0
+      || pid == NULL || atoi(pid) != getpid()) {
+    greeting = "ENVIRONMENT\n";
+  }
+
+  fds[0].fd = STDIN_FILENO;
+  fds[0].events = POLLIN;
+  fds[1].fd = 3;
+  fds[1].events = POLLIN;
+  for (;;) {
+    do {
+      err = poll(fds, 2, -1);
+    } while (err == -1 && errno == EINTR);
+    if (err == -1 || fds[0].revents || (fds[1].revents & ~POLLIN)) {
+      break;
+    }
+    if ((fd = accept(3, NULL, NULL)) != -1) {
+      do {
+        err = write(fd, greeting, strlen(greeting));
+      } while (err == -1 && errno == EINTR);
+      close(fd);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
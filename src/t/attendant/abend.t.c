@@ -12,12 +12,12 @@
 
 static int count = 0;
 
-void starter(int restart) {
+void starter(int restart, int uptime) {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   count++;
   if (count < 3) {
-    attendant.start(strcat(getcwd(path, PATH_MAX), restart ? "/t/bin/when" : "/no-exist"), argv);
+    attendant.start(strcat(getcwd(path, PATH_MAX), restart ? "/t/bin/when" : "/no-exist"), argv, 0);
   }
 }
 
@@ -38,6 +38,8 @@ int main() {
   char const *exit = "exit\n";
   struct attendant__initializer initializer;
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
   initializer.connector = connector;
   strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
@@ -47,7 +49,7 @@ int main() {
 
   attendant.initialize(&initializer);
 
-  starter(0);
+  starter(0, 0);
   attendant.ready();
   attendant.shutdown();
 
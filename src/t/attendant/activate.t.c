@@ -0,0 +1,100 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A lazy plugin attendant that holds the listening socket of the plugin server
+ * process and launches it on the first connection. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/activated"), argv, 0);
+}
+
+static attendant__pipe_t stdin_pipe;
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  stdin_pipe = in;
+}
+
+static struct sockaddr_un address;
+
+/* Connect to the listener. Returns the socket, or -1. */
+static int dial() {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0), err;
+  HANDLE_EINTR(connect(fd, (struct sockaddr *) &address, sizeof(address)), err);
+  if (err == -1) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/* Read the greeting of the plugin server process and hang up. */
+static int greeted(int fd) {
+  char buffer[64];
+  int err;
+  memset(buffer, 0, sizeof(buffer));
+  HANDLE_EINTR(read(fd, buffer, sizeof(buffer) - 1), err);
+  close(fd);
+  return strcmp(buffer, "HELLO\n") == 0;
+}
+
+int main() {
+  char runtime[] = "/tmp/attendant.XXXXXX";
+  struct attendant__initializer initializer;
+  int fd, err;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.lazy = 1;
+  initializer.activate = 1;
+
+  mkdtemp(runtime);
+  snprintf(initializer.listener, sizeof(initializer.listener),
+    "%s/activate.t", runtime);
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, initializer.listener);
+
+  printf("1..6\n");
+
+  attendant.initialize(&initializer);
+
+  ok(count == 0 && attendant.poll_state() == ATTENDANT_STATE_DORMANT, "dormant");
+
+  fd = dial();
+  ok(fd != -1, "connection waits");
+  ok(greeted(fd) && count == 1, "activated");
+  ok(attendant.ready() == 1 && count == 1, "ready");
+
+  attendant.request_retry(0);
+  fd = dial();
+  ok(greeted(fd) && attendant.ready() == 1 && count == 2, "restarted");
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  rmdir(runtime);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process that uses the companion library says when it is
+ * ready, and is told when to shut down. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/companion"), argv, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  long long started;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.companion = 1;
+
+  printf("1..5\n");
+
+  attendant.initialize(&initializer);
+
+  started = attendant.clock();
+  starter(0, 0);
+  ok(attendant.ready() == 1 && attendant.clock() - started >= 300, "gated");
+
+  started = attendant.clock();
+  ok(attendant.retry(0) == 1 && count == 2
+    && attendant.clock() - started >= 300, "gated after restart");
+
+  /* No IPC of our own, the plugin server process is told to shut down. */
+  ok(attendant.shutdown() == 1, "shutdown");
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
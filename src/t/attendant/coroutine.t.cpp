@@ -0,0 +1,109 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <coroutine>
+#include <exception>
+
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../../../attendant.hpp"
+#include "../../../eintr.h"
+
+extern "C" {
+#include "../ok.h"
+}
+
+using namespace attendant_cpp;
+
+/* Drive the attendant with coroutines from a single thread. */
+
+static int count = 0;
+
+static void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
+}
+
+static char fifo[PATH_MAX];
+
+static void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  const char *pipe = "pipe\n";
+  int err;
+  HANDLE_EINTR(write(in, pipe, strlen(pipe)), err);
+  HANDLE_EINTR(read(out, fifo, sizeof(fifo)), err);
+  fifo[strlen(fifo) - 1] = '\0';
+}
+
+/* A coroutine that runs until it is done and no further. */
+struct task {
+  struct promise_type {
+    task get_return_object() { return task(); }
+    std::suspend_never initial_suspend() { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+static task echo(reactor &r, channel &from, char *buffer, bool &read) {
+  ssize_t size = co_await from.read(r, buffer, 5);
+  read = size == 5;
+}
+
+static task lifecycle(reactor &r, session &s, bool &finished) {
+  channel from, to;
+  char buffer[8];
+  const char *exit = "exit\n";
+  bool read = false;
+  int fds[2], fd, err;
+
+  ok(co_await ready(r) == 1, "ready");
+  ok(co_await retry(r, 0) == 1 && count == 2, "retry");
+  ok(attendant.retry(0) == 1 && count == 3, "retry acknowledged");
+
+  ok(pipe(fds) == 0, "pipe");
+  from = channel(fds[0]);
+  to = channel(fds[1]);
+  memset(buffer, 0, sizeof(buffer));
+  echo(r, from, buffer, read);
+  ok(! read, "read suspended");
+  ok(co_await to.write(r, "hello", 5) == 5, "write");
+
+  s.request_shutdown();
+  fd = open(fifo, O_WRONLY);
+  HANDLE_EINTR(write(fd, exit, strlen(exit)), err);
+  close(fd);
+
+  ok(co_await done(r, s), "done");
+  ok(read && strcmp(buffer, "hello") == 0, "read resumed");
+
+  finished = true;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  bool finished = false;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..8\n");
+
+  session s(initializer);
+  starter(0, 0);
+
+  reactor r;
+  lifecycle(r, s, finished);
+  while (! finished && r.run_once(std::chrono::seconds(30)));
+
+  return EXIT_SUCCESS;
+}
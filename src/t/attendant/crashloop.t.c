@@ -0,0 +1,78 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+
+/* A plugin server process that dies at startup, every time. */
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static int count = 0;
+static struct timespec connected[8];
+
+void starter(int restart, int uptime) {
+  char const * argv[] = { "-c", "exit 1", NULL };
+  attendant.start("/bin/sh", argv, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  pthread_mutex_lock(&mutex);
+  if (count < 8) {
+    clock_gettime(CLOCK_MONOTONIC, &connected[count]);
+  }
+  count++;
+  pthread_mutex_unlock(&mutex);
+}
+
+static long elapsed(struct timespec *from, struct timespec *to) {
+  return (to->tv_sec - from->tv_sec) * 1000
+       + (to->tv_nsec - from->tv_nsec) / 1000000;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  int status;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.backoff.window = 30000;
+  initializer.backoff.limit = 4;
+  initializer.backoff.initial = 200;
+  initializer.backoff.maximum = 1000;
+  initializer.backoff.cooldown = 60000;
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+
+  starter(0, 0);
+
+  /* Keep asking until the circuit opens. */
+  while ((status = attendant.retry(0)) == 1);
+
+  ok(status == 0 && attendant.errors().circuit, "circuit open");
+  ok(count == 4, "crash limit %d", count);
+  ok(elapsed(&connected[1], &connected[2]) >= 100, "backed off %ld",
+    elapsed(&connected[1], &connected[2]));
+  ok(attendant.errors().wait > 50000, "wait %d", attendant.errors().wait);
+  ok(attendant.ready() == 0 && attendant.errors().circuit,
+    "ready does not block");
+  ok(attendant.ready_until(-1) == ATTENDANT_CIRCUIT_OPEN,
+    "ready until says why");
+
+  /* Shutdown cancels the cool down. */
+  attendant.shutdown();
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -11,11 +11,11 @@
 #include "../../../eintr.h"
 
 int count = 0;
-void starter(int restart) {
+void starter(int restart, int uptime) {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   if (count++ < 1) {
-    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv);
+    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
   }
 }
 
@@ -36,6 +36,8 @@ int main() {
   char const * exit = "exit\n";
   struct attendant__initializer initializer;
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
   initializer.connector = connector;
   strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
@@ -44,7 +46,7 @@ int main() {
   printf("1..4\n");
 
   attendant.initialize(&initializer);
-  starter(0);
+  starter(0, 0);
   attendant.ready();
   attendant.shutdown();
 
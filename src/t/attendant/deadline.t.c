@@ -0,0 +1,76 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* The `when` server takes a couple of seconds to start, which is plenty of
+ * time to miss a deadline. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
+}
+
+static char fifo[PATH_MAX];
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  const char *pipe = "pipe\n";
+  int err;
+  HANDLE_EINTR(write(in, pipe, strlen(pipe)), err);
+  HANDLE_EINTR(read(out, fifo, sizeof(fifo)), err);
+  fifo[strlen(fifo) - 1] = '\0';
+}
+
+int main() {
+  int err, fd;
+  long long begin, elapsed;
+  char const *exit = "exit\n";
+  struct attendant__initializer initializer;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+
+  starter(0, 0);
+
+  begin = attendant.clock();
+  ok(attendant.ready_until(begin + 100) == ATTENDANT_NOT_YET, "ready not yet");
+  elapsed = attendant.clock() - begin;
+  ok(elapsed >= 100 && elapsed < 1000, "ready waited %lld", elapsed);
+  ok(attendant.ready_until(0) == ATTENDANT_NOT_YET, "ready past deadline");
+  ok(attendant.ready(), "ready");
+
+  ok(attendant.retry_until(0, attendant.clock() + 100) == ATTENDANT_NOT_YET,
+    "retry not yet");
+  ok(attendant.retry_until(0, attendant.clock() + 30000) == 1 && count == 2,
+    "retry restarted once %d", count);
+
+  attendant.shutdown();
+
+  fd = open(fifo, O_WRONLY);
+  HANDLE_EINTR(write(fd, exit, strlen(exit)), err);
+  close(fd);
+
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin stub that talks to the plugin server process through the stable
+ * endpoint, across restarts it never sees. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX], instance[32];
+  char const * argv[] = { instance, NULL };
+  count++;
+  sprintf(instance, "%d", count);
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/framed"), argv, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
+/* Send a request and return the flags of the reply, or -1 if the reply is not
+ * the one we expected. */
+static int call(unsigned int id, unsigned int flags, const char *payload) {
+  struct attendant__frame header;
+  char buffer[256];
+  int fd = attendant.endpoint(), err;
+
+  header.length = strlen(payload);
+  header.id = id;
+  header.flags = flags;
+  HANDLE_EINTR(write(fd, &header, sizeof(header)), err);
+  HANDLE_EINTR(write(fd, payload, header.length), err);
+
+  HANDLE_EINTR(read(fd, &header, sizeof(header)), err);
+  if (err != sizeof(header) || header.id != id) {
+    return -1;
+  }
+  memset(buffer, 0, sizeof(buffer));
+  if (header.length) {
+    HANDLE_EINTR(read(fd, buffer, header.length), err);
+    if (strcmp(buffer, payload) != 0) {
+      return -1;
+    }
+  }
+  return header.flags;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  int endpoint;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.journal = 8;
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  endpoint = attendant.endpoint();
+  ok(endpoint != -1 && attendant.ready() == 1, "ready");
+
+  ok(call(1, 0, "echo") == 0, "echo");
+  ok(call(2, ATTENDANT_FRAME_IDEMPOTENT, "first") == 0 && count == 2,
+    "replayed");
+  ok(call(3, 0, "exit") == ATTENDANT_FRAME_LOST, "lost");
+  ok(call(4, 0, "echo") == 0 && count == 3 && attendant.endpoint() == endpoint,
+    "same endpoint");
+
+  attendant.shutdown();
+  ok(call(5, ATTENDANT_FRAME_IDEMPOTENT, "exit") == ATTENDANT_FRAME_LOST,
+    "lost at shutdown");
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
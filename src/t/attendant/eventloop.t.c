@@ -0,0 +1,90 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* Drive the attendant from a single threaded event loop. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
+}
+
+static char fifo[PATH_MAX];
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  const char *pipe = "pipe\n";
+  int err;
+  HANDLE_EINTR(write(in, pipe, strlen(pipe)), err);
+  HANDLE_EINTR(read(out, fifo, sizeof(fifo)), err);
+  fifo[strlen(fifo) - 1] = '\0';
+}
+
+/* Wait on the event loop until we reach the given state. */
+static int until(int expected) {
+  struct pollfd pollfd;
+  int state, err;
+
+  pollfd.fd = attendant.fd();
+  pollfd.events = POLLIN;
+  while ((state = attendant.poll_state()) != expected) {
+    HANDLE_EINTR(poll(&pollfd, 1, 30000), err);
+    if (err == 0) {
+      break;
+    }
+  }
+
+  return state;
+}
+
+int main() {
+  int err, fd;
+  char const *exit = "exit\n";
+  struct attendant__initializer initializer;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+
+  starter(0, 0);
+
+  ok(attendant.poll_state() == ATTENDANT_STATE_STARTING, "starting");
+  ok(until(ATTENDANT_STATE_RUNNING) == ATTENDANT_STATE_RUNNING, "running");
+
+  ok(attendant.request_retry(0) == ATTENDANT_NOT_YET, "retry requested");
+  ok(until(ATTENDANT_STATE_RUNNING) == ATTENDANT_STATE_RUNNING && count == 2,
+    "restarted");
+  ok(attendant.request_retry(0) == 1, "retry after restart");
+
+  attendant.request_shutdown();
+  ok(until(ATTENDANT_STATE_SHUTDOWN) == ATTENDANT_STATE_SHUTDOWN, "shutdown");
+
+  fd = open(fifo, O_WRONLY);
+  HANDLE_EINTR(write(fd, exit, strlen(exit)), err);
+  close(fd);
+
+  ok(until(ATTENDANT_STATE_DONE) == ATTENDANT_STATE_DONE, "done");
+  attendant.done(-1);
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* Two plugin attendants, each with a server of its own, that do not disturb
+ * each other. */
+
+struct tenant {
+  int count;
+  attendant__pipe_t in;
+};
+
+void starter(struct attendant__process *process, void *context, int restart,
+  int uptime) {
+  struct tenant *tenant = (struct tenant *) context;
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  tenant->count++;
+  attendant_start(process, strcat(getcwd(path, PATH_MAX), "/t/bin/server"),
+    argv, 0);
+}
+
+void connector(void *context, attendant__pipe_t in, attendant__pipe_t out) {
+  ((struct tenant *) context)->in = in;
+}
+
+int main() {
+  int err, i;
+  struct attendant__initializer initializer;
+  struct attendant__process *processes[2];
+  struct tenant tenants[2];
+
+  memset(&initializer, 0, sizeof(initializer));
+  memset(tenants, 0, sizeof(tenants));
+
+  initializer.starter_r = starter;
+  initializer.connector_r = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..6\n");
+
+  for (i = 0; i < 2; i++) {
+    initializer.context = &tenants[i];
+    processes[i] = attendant_new(&initializer);
+  }
+  ok(processes[0] && processes[1], "new");
+
+  initializer.starter_r = NULL;
+  ok(attendant_new(&initializer) == NULL, "new without starter");
+
+  for (i = 0; i < 2; i++) {
+    starter(processes[i], &tenants[i], 0, 0);
+  }
+  ok(attendant_ready(processes[0]) && attendant_ready(processes[1]), "ready");
+
+  ok(attendant_retry(processes[0], 0), "retry");
+  ok(tenants[0].count == 2 && tenants[1].count == 1, "restarted one");
+
+  for (i = 0; i < 2; i++) {
+    attendant_shutdown(processes[i]);
+    HANDLE_EINTR(write(tenants[i].in, "\n", 1), err);
+  }
+  ok(attendant_done(processes[0], 30000) && attendant_done(processes[1], 30000),
+    "done");
+
+  for (i = 0; i < 2; i++) {
+    attendant_destroy(processes[i]);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A lazy plugin attendant with an idle policy launches on demand and goes
+ * dormant when left alone. A call with a deadline does not run the starter on
+ * the calling thread. */
+
+static volatile int count = 0;
+static pthread_t started_by;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  started_by = pthread_self();
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server"), argv, 0);
+}
+
+static attendant__pipe_t stdin_pipe;
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  stdin_pipe = in;
+}
+
+/* Wait until well past the idle period for the dormant state. */
+static int dormant() {
+  long long deadline = attendant.clock() + 5000;
+  while (attendant.poll_state() != ATTENDANT_STATE_DORMANT
+      && attendant.clock() < deadline) {
+    usleep(50000);
+  }
+  return attendant.poll_state() == ATTENDANT_STATE_DORMANT;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  long long deadline;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.lazy = 1;
+  initializer.idle = 250;
+
+  printf("1..9\n");
+
+  attendant.initialize(&initializer);
+
+  ok(count == 0 && attendant.poll_state() == ATTENDANT_STATE_DORMANT, "lazy");
+  ok(attendant.ready() == 1 && count == 1, "launched on demand");
+  ok(dormant() && count == 1, "idle");
+  ok(attendant.ready() == 1 && count == 2, "relaunched on demand");
+  ok(dormant(), "idle again");
+  ok(attendant.ready_until(0) == ATTENDANT_NOT_YET, "summoned");
+  deadline = attendant.clock() + 5000;
+  while (count != 3 && attendant.clock() < deadline) {
+    usleep(10000);
+  }
+  ok(attendant.ready() == 1 && count == 3
+    && ! pthread_equal(started_by, pthread_self()), "started off the caller");
+  ok(dormant(), "idle once more");
+
+  attendant.shutdown();
+  ok(attendant.done(1000), "shutdown while dormant");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../errors.h"
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process leaves a file to the plugin server processes that
+ * follow it. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/heir"), argv, 0);
+}
+
+static attendant__pipe_t stdin_pipe;
+static char said[64];
+
+/* Remember what the plugin server process said when it started. */
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  int err;
+  stdin_pipe = in;
+  memset(said, 0, sizeof(said));
+  HANDLE_EINTR(read(out, said, sizeof(said) - 1), err);
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  int err;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.inherit = 4;
+
+  printf("1..6\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && strcmp(said, "CREATED\n") == 0, "created");
+  ok(attendant.retry(0) == 1 && count == 2
+    && strcmp(said, "INHERITED instance 1\n") == 0, "inherited");
+  ok(attendant.retry(0) == 1 && count == 3
+    && strcmp(said, "INHERITED instance 1\n") == 0, "inherited again");
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  initializer.inherit = 63;
+  ok(attendant.initialize(&initializer) == -1
+    && attendant.errors().attendant == INITIALIZE_TOO_MANY_INHERITED,
+    "too many inherited");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* Standard out and standard error of two plugin server processes go to logs,
+ * one rotated when it grows too large, the other cut short when written to too
+ * quickly. */
+
+struct tenant {
+  int count;
+  attendant__pipe_t in;
+};
+
+void starter(struct attendant__process *process, void *context, int restart,
+  int uptime) {
+  struct tenant *tenant = (struct tenant *) context;
+  char path[PATH_MAX];
+  char const * crash[] = { "crash", NULL };
+  char const * exit[] = { NULL };
+  tenant->count++;
+  attendant_start(process, strcat(getcwd(path, PATH_MAX), "/t/bin/crash"),
+    tenant->count == 1 ? crash : exit, 0);
+}
+
+void connector(void *context, attendant__pipe_t in, attendant__pipe_t out) {
+  ((struct tenant *) context)->in = in;
+}
+
+/* Append the contents of a file to a buffer, returning the new length. */
+static size_t slurp(const char *path, char *buffer, size_t length,
+  size_t size) {
+  FILE *file = fopen(path, "r");
+  if (file != NULL) {
+    length += fread(buffer + length, 1, size - length - 1, file);
+    fclose(file);
+  }
+  buffer[length] = '\0';
+  return length;
+}
+
+static void clean(const char *path) {
+  char rotated[FILENAME_MAX + 8];
+  int i;
+  unlink(path);
+  for (i = 1; i < 4; i++) {
+    sprintf(rotated, "%s.%d", path, i);
+    unlink(rotated);
+  }
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  struct attendant__process *processes[2];
+  struct tenant tenants[2];
+  char paths[2][FILENAME_MAX], rotated[FILENAME_MAX + 8];
+  char expected[1024], logged[1024];
+  size_t length;
+  long long deadline;
+  int err, i;
+
+  memset(&initializer, 0, sizeof(initializer));
+  memset(tenants, 0, sizeof(tenants));
+
+  initializer.starter_r = starter;
+  initializer.connector_r = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.stdio = ATTENDANT_STDIO_LOG;
+
+  for (i = 0; i < 2; i++) {
+    sprintf(paths[i], "%s/t/log.%d", getcwd(rotated, sizeof(rotated)), i);
+    clean(paths[i]);
+  }
+
+  printf("1..5\n");
+
+  strcpy(initializer.logging.path, paths[0]);
+  initializer.logging.size = 256;
+  initializer.logging.keep = 2;
+  initializer.context = &tenants[0];
+  processes[0] = attendant_new(&initializer);
+
+  strcpy(initializer.logging.path, paths[1]);
+  initializer.logging.size = 0;
+  initializer.logging.keep = 0;
+  initializer.logging.rate = 300;
+  initializer.context = &tenants[1];
+  processes[1] = attendant_new(&initializer);
+
+  ok(processes[0] && processes[1], "new");
+
+  for (i = 0; i < 2; i++) {
+    starter(processes[i], &tenants[i], 0, 0);
+  }
+  ok(attendant_ready(processes[0]) && attendant_ready(processes[1]), "ready");
+
+  for (i = 0; i < 2; i++) {
+    HANDLE_EINTR(write(tenants[i].in, "\n", 1), err);
+  }
+  deadline = attendant.clock() + 10000;
+  while ((tenants[0].count < 2 || tenants[1].count < 2)
+      && attendant.clock() < deadline) {
+    usleep(1000);
+  }
+  ok(tenants[0].count == 2 && tenants[1].count == 2, "restarted");
+
+  for (i = 0; i < 2; i++) {
+    attendant_ready(processes[i]);
+    attendant_shutdown(processes[i]);
+    HANDLE_EINTR(write(tenants[i].in, "\n", 1), err);
+  }
+  for (i = 0; i < 2; i++) {
+    attendant_done(processes[i], 30000);
+    attendant_destroy(processes[i]);
+  }
+
+  /* What is left of the log is the last of what was written, oldest first. */
+  strcpy(expected, "hello\n");
+  for (i = 0; i < 100; i++) {
+    sprintf(expected + strlen(expected), "line %d\n", i);
+  }
+  strcat(expected, "fatal: out of widgets\nhello\n");
+  sprintf(rotated, "%s.2", paths[0]);
+  length = slurp(rotated, logged, 0, sizeof(logged));
+  sprintf(rotated, "%s.1", paths[0]);
+  length = slurp(rotated, logged, length, sizeof(logged));
+  length = slurp(paths[0], logged, length, sizeof(logged));
+  sprintf(rotated, "%s.3", paths[0]);
+  ok(strlen(expected) == 824 && length == 824 - 256
+    && strcmp(logged, expected + 256) == 0 && access(rotated, F_OK) == -1,
+    "rotated");
+
+  length = slurp(paths[1], logged, 0, sizeof(logged));
+  ok(strncmp(logged, "hello\nline 0\n", 13) == 0 && length < 824
+    && strstr(logged, "attendant: dropped ") != NULL, "rate");
+
+  for (i = 0; i < 2; i++) {
+    clean(paths[i]);
+  }
+
+  return EXIT_SUCCESS;
+}
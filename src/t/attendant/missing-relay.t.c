@@ -10,24 +10,33 @@
 #include "../ok.h"
 #include "../../../eintr.h"
 
-void starter(int restart) {
+void starter(int restart, int uptime) {
   struct attendant__errors errors = attendant.errors();
   ok(errors.attendant == START_CANNOT_EXECV, "start cannot execve");
   ok(errors.system == ENOENT, "enoent");
 }
 
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
 int main() {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   struct attendant__initializer initializer;
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
+  initializer.connector = connector;
   strcat(getcwd(initializer.relay, PATH_MAX), "/relay-x");
   initializer.canary = 31;
 
-  printf("1..2\n");
+  printf("1..3\n");
+  ok(attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server"), argv, 0)
+    == -1 && attendant.errors().attendant == START_NOT_INITIALIZED,
+    "start not initialized");
   attendant.initialize(&initializer);
-  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server"), argv);
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server"), argv, 0);
   attendant.ready();
   attendant.destroy();  
 
@@ -10,24 +10,30 @@
 #include "../ok.h"
 #include "../../../eintr.h"
 
-void starter(int restart) {
+void starter(int restart, int uptime) {
   struct attendant__errors errors = attendant.errors();
   ok(errors.attendant == RELAY_CANNOT_EXEC, "relay cannot exec");
   ok(errors.system == ENOENT, "enoent");
 }
 
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
 int main() {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   struct attendant__initializer initializer;
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
-  strcat(getcwd(initializer.relay, PATH_MAX), "/relay-x");
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, PATH_MAX), "/relay");
   initializer.canary = 31;
 
   printf("1..2\n");
   attendant.initialize(&initializer);
-  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server-x"), argv);
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/server-x"), argv, 0);
   attendant.ready();
   attendant.destroy();  
 
@@ -0,0 +1,109 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "../../../attendant_policy.hpp"
+
+extern "C" {
+#include "../ok.h"
+}
+
+using namespace attendant_cpp;
+
+/* Run the testing server under two different instantiations of the policy
+ * based attendant. */
+
+static void connector(int in, int out) {
+}
+
+/* The Linux specific policies, where we have them. */
+#if defined(__linux__) && defined(SYS_pidfd_open)
+typedef pidfd_exit linux_exit;
+#else
+typedef waitpid_exit linux_exit;
+#endif
+#ifdef __linux__
+typedef futex_wait linux_wait;
+#else
+typedef condvar_wait linux_wait;
+#endif
+
+/* The testing server reports anything unclean about its environment before it
+ * reports that it is running. The canary is the one file descriptor we expect
+ * to find open. */
+static bool clean(int out) {
+  char line[256];
+  size_t i;
+  ssize_t size;
+  for (;;) {
+    i = 0;
+    do {
+      do {
+        size = read(out, &line[i], 1);
+      } while (size == -1 && errno == EINTR);
+    } while (size == 1 && line[i] != '\n' && ++i < sizeof(line) - 1);
+    line[i] = '\0';
+    if (size != 1) {
+      return false;
+    }
+    if (strcmp(line, "RUNNING") == 0) {
+      return true;
+    }
+    if (strcmp(line, "OPEN: 31.") != 0) {
+      return false;
+    }
+  }
+}
+
+static void quit(int in) {
+  ssize_t err;
+  do {
+    err = write(in, "\n", 1);
+  } while (err == -1 && errno == EINTR);
+}
+
+int main() {
+  char cwd[PATH_MAX];
+  std::string relay, server;
+
+  getcwd(cwd, sizeof(cwd));
+  relay = std::string(cwd) + "/relay";
+  server = std::string(cwd) + "/t/bin/server";
+
+  printf("1..10\n");
+
+  {
+    posix_attendant attendant(relay, 31, connector);
+    attendant.start(server, {});
+    ok(attendant.ready(monotonic() + 30000) == 1, "fork ready");
+    ok(clean(attendant.out()), "fork clean");
+    ok(attendant.retry(0, monotonic() + 30000) == 1, "fork retry");
+    attendant.shutdown();
+    quit(attendant.in());
+    ok(attendant.done(monotonic() + 30000), "fork done");
+  }
+
+  {
+    basic_attendant<posix_spawn_exec, linux_exit, linux_wait, never_restart>
+      attendant(relay, 31, connector);
+    attendant.start(server, {});
+    ok(attendant.ready(monotonic() + 30000) == 1, "spawn ready");
+    ok(clean(attendant.out()), "spawn clean");
+    quit(attendant.in());
+    ok(attendant.done(monotonic() + 30000), "spawn done");
+    ok(attendant.ready(0) == 0, "spawn never restarted");
+  }
+
+  {
+    posix_attendant attendant(std::string(cwd) + "/relay-x", 31, connector);
+    attendant.start(server, {});
+    ok(attendant.ready(monotonic() + 30000) == 0, "missing relay not ready");
+    ok(attendant.done(monotonic() + 30000), "missing relay done");
+  }
+
+  return EXIT_SUCCESS;
+}
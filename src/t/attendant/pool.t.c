@@ -0,0 +1,87 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A pool of two, pinned. Dispatch spreads the calls in flight, and passes over
+ * a member that is out of service. */
+
+struct member {
+  attendant__pipe_t in;
+};
+
+void starter(struct attendant__process *process, void *context, int restart,
+  int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  attendant_start(process, strcat(getcwd(path, PATH_MAX), "/t/bin/server"),
+    argv, 0);
+}
+
+void connector(void *context, attendant__pipe_t in, attendant__pipe_t out) {
+  ((struct member *) context)->in = in;
+}
+
+/* Tell the member in the slot to exit and wait for it. */
+static int stop(struct attendant__pool *pool, struct member *members, int slot) {
+  struct attendant__process *process = attendant_pool_process(pool, slot);
+  int err;
+  attendant_shutdown(process);
+  HANDLE_EINTR(write(members[slot].in, "\n", 1), err);
+  return attendant_done(process, 30000);
+}
+
+int main() {
+  int i, slot, counts[2] = { 0, 0 }, only;
+  struct attendant__initializer initializer;
+  struct attendant__pool *pool;
+  struct member members[2];
+  void *contexts[] = { &members[0], &members[1] };
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter_r = starter;
+  initializer.connector_r = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..5\n");
+
+  pool = attendant_pool_new(&initializer, contexts, 2, ATTENDANT_PIN_CORE);
+  ok(pool != NULL && attendant_pool_size(pool) == 2, "new");
+
+  for (i = 0; i < 2; i++) {
+    starter(attendant_pool_process(pool, i), contexts[i], 0, 0);
+  }
+  ok(attendant_ready(attendant_pool_process(pool, 0))
+    && attendant_ready(attendant_pool_process(pool, 1)), "ready");
+
+  for (i = 0; i < 4; i++) {
+    counts[attendant_pool_acquire(pool, ATTENDANT_BALANCE_LEAST)]++;
+  }
+  ok(counts[0] == 2 && counts[1] == 2, "least outstanding");
+  for (i = 0; i < 4; i++) {
+    attendant_pool_release(pool, i % 2);
+  }
+
+  stop(pool, members, 0);
+  only = 1;
+  for (i = 0; i < 8; i++) {
+    slot = attendant_pool_acquire(pool, i % 2);
+    only = only && slot == 1;
+    attendant_pool_release(pool, slot);
+  }
+  ok(only, "passed over");
+
+  ok(stop(pool, members, 1), "done");
+
+  attendant_pool_destroy(pool);
+
+  return EXIT_SUCCESS;
+}
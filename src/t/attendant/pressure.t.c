@@ -0,0 +1,98 @@
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A pressure stall trigger that fires is counted and passed on to a plugin
+ * server process that uses the companion library. We make CPU pressure by
+ * running more busy processes than there are CPUs, niced, so that they wait on
+ * each other more than on us. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * pressure[] = { "pressure", NULL };
+  char const * beat[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/companion"),
+    count == 1 ? pressure : beat, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  struct attendant__stress stress;
+  pid_t spinners[64];
+  long long deadline;
+  int i, spinning, err;
+
+  if (access("/proc/pressure/cpu", R_OK) == -1) {
+    printf("1..0 # skip no pressure stall information\n");
+    return EXIT_SUCCESS;
+  }
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.companion = 1;
+  initializer.pressure.window = 2000;
+  initializer.pressure.some = 500;
+  initializer.pressure.full = 500;
+  initializer.pressure.cpu = 1;
+
+  printf("1..6\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && count == 1, "ready");
+
+  spinning = sysconf(_SC_NPROCESSORS_ONLN) + 1;
+  spinning = spinning > 64 ? 64 : spinning;
+  for (i = 0; i < spinning; i++) {
+    if ((spinners[i] = fork()) == 0) {
+      nice(19);
+      for (;;) {
+      }
+    }
+  }
+
+  /* The plugin server process exits when it is told of pressure. */
+  deadline = attendant.clock() + 10000;
+  while (count < 2 && attendant.clock() < deadline) {
+    usleep(1000);
+  }
+
+  for (i = 0; i < spinning; i++) {
+    kill(spinners[i], SIGKILL);
+    HANDLE_EINTR(waitpid(spinners[i], NULL, 0), err);
+  }
+
+  ok(count == 2, "told of pressure");
+  stress = attendant.pressure();
+  ok(stress.cpu_fired > 0 && stress.fired > 0
+    && (stress.last & ATTENDANT_PRESSURE_CPU), "counted");
+  ok(stress.cpu >= 0 && stress.cpu <= 100 && stress.some >= 0
+    && stress.full >= 0, "levels");
+
+  attendant.shutdown();
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
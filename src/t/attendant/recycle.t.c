@@ -0,0 +1,77 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process that grows too large is sampled, recycled, and its
+ * resource usage noted. A recycle is not a crash, so it does not open a
+ * circuit that a single crash would. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/leak"), argv, 0);
+}
+
+static attendant__pipe_t stdin_pipe;
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  stdin_pipe = in;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  struct attendant__sample sample;
+  struct attendant__usage usage;
+  int err, i, pid;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.recycle.interval = 50;
+  initializer.recycle.rss = 32 * 1024 * 1024;
+  initializer.backoff.window = 30000;
+  initializer.backoff.limit = 1;
+  initializer.backoff.cooldown = 60000;
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1, "ready");
+  usleep(200 * 1000);
+  sample = attendant.sample();
+  pid = sample.pid;
+  ok(pid != 0 && sample.rss > 0 && sample.uptime > 0, "sampled");
+
+  /* No one calls `retry`. */
+  for (i = 0; i < 30000 && count < 2; i++) {
+    usleep(1000);
+  }
+  ok(count == 2, "recycled");
+
+  usage = attendant.usage();
+  ok(usage.pid == pid && usage.maxrss > 32 * 1024 * 1024, "usage");
+  ok(attendant.ready() == 1 && ! attendant.errors().circuit, "not a crash");
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
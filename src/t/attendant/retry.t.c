@@ -13,11 +13,11 @@
 
 static int count = 0;
 
-void starter(int restart) {
+void starter(int restart, int uptime) {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   if (count++ < 3) {
-    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv);
+    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
   }
 }
 
@@ -122,6 +122,8 @@ int main() {
 
   printf("1..14\n");
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
   initializer.connector = connector;
   strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
@@ -131,7 +133,7 @@ int main() {
   attendant.initialize(&initializer);
 
   /* Start the server. */
-  starter(0);
+  starter(0, 0);
   attendant.ready();
 
   expected.name = "first";
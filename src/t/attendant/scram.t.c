@@ -11,11 +11,11 @@
 
 static int count = 0;
 
-void starter(int restart) {
+void starter(int restart, int uptime) {
   char path[PATH_MAX];
   char const * argv[] = { NULL };
   if (count++ < 3) {
-    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv);
+    attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/when"), argv, 0);
   }
 }
 
@@ -36,13 +36,15 @@ int main() {
 
   printf("1..3\n");
 
+  memset(&initializer, 0, sizeof(initializer));
+
   initializer.starter = starter;
   initializer.connector = connector;
   strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
   initializer.canary = 31;
 
   attendant.initialize(&initializer);
-  starter(0);
+  starter(0, 0);
   attendant.ready();
   attendant.shutdown();
   ok(! attendant.done(250), "can't exit");
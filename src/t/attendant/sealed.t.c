@@ -0,0 +1,69 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A blob given once to `start_sealed` is passed to every plugin server process
+ * that follows, and none of them can change it. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  const char *manifest = "manifest 1";
+  count++;
+  strcat(getcwd(path, PATH_MAX), "/t/bin/sealed");
+  if (count == 1) {
+    attendant.start_sealed(path, argv, 0, manifest, strlen(manifest));
+  } else {
+    attendant.start(path, argv, 0);
+  }
+}
+
+static attendant__pipe_t stdin_pipe;
+static char said[64];
+
+/* Remember what the plugin server process said when it started. */
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  int err;
+  stdin_pipe = in;
+  memset(said, 0, sizeof(said));
+  HANDLE_EINTR(read(out, said, sizeof(said) - 1), err);
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  int err;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+
+  printf("1..4\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && strcmp(said, "BLOB manifest 1 SEALED\n") == 0,
+    "sealed");
+  ok(attendant.retry(0) == 1 && count == 2
+    && strcmp(said, "BLOB manifest 1 SEALED\n") == 0, "passed again");
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* Two plugin attendants that share one plugin server process, as if they were
+ * in two host processes. */
+
+struct host {
+  int count;
+  attendant__pipe_t in, out;
+};
+
+void starter(struct attendant__process *process, void *context, int restart,
+  int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { "shared.t", NULL };
+  ((struct host *) context)->count++;
+  attendant_start(process, strcat(getcwd(path, PATH_MAX), "/t/bin/shared"),
+    argv, 0);
+}
+
+/* When we launch, we wait for the plugin server process to say that it is
+ * listening. */
+void connector(void *context, attendant__pipe_t in, attendant__pipe_t out) {
+  struct host *host = (struct host *) context;
+  char ch;
+  int err;
+  host->in = in;
+  host->out = out;
+  if (in != out) {
+    do {
+      HANDLE_EINTR(read(out, &ch, 1), err);
+    } while (err == 1 && ch != '\n');
+  }
+}
+
+/* Tell the plugin server process that we are leaving and wait for it to hang
+ * up on us. */
+static int leave(struct attendant__process *process, struct host *host) {
+  int err;
+  attendant_shutdown(process);
+  HANDLE_EINTR(write(host->in, "\n", 1), err);
+  return attendant_done(process, 30000);
+}
+
+int main() {
+  char runtime[] = "/tmp/attendant.XXXXXX", path[PATH_MAX];
+  struct attendant__initializer initializer;
+  struct attendant__process *launcher, *attached;
+  struct host hosts[2];
+
+  memset(&initializer, 0, sizeof(initializer));
+  memset(hosts, 0, sizeof(hosts));
+
+  setenv("XDG_RUNTIME_DIR", mkdtemp(runtime), 1);
+  sprintf(path, "%s/shared.t", runtime);
+
+  initializer.starter_r = starter;
+  initializer.connector_r = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  strcpy(initializer.rendezvous, "shared.t");
+
+  printf("1..7\n");
+
+  initializer.context = &hosts[0];
+  launcher = attendant_new(&initializer);
+  starter(launcher, &hosts[0], 0, 0);
+  ok(attendant_ready(launcher) && hosts[0].in != hosts[0].out, "launched");
+
+  initializer.context = &hosts[1];
+  attached = attendant_new(&initializer);
+  starter(attached, &hosts[1], 0, 0);
+  ok(attendant_ready(attached) && hosts[1].in == hosts[1].out, "attached");
+
+  ok(attendant_retry(attached, 0) && hosts[1].count == 2
+    && hosts[1].in == hosts[1].out, "reattached");
+
+  ok(leave(attached, &hosts[1]), "left");
+  ok(access(path, F_OK) == 0, "still running");
+  ok(leave(launcher, &hosts[0]) && access(path, F_OK) == -1, "last one out");
+
+  attendant_destroy(attached);
+  attendant_destroy(launcher);
+
+  /* A rendezvous path that does not fit in a socket address is an error, and
+   * the failure leaves the host alone. */
+  memset(initializer.rendezvous, 'x', 200);
+  initializer.rendezvous[200] = '\0';
+  ok(attendant_new(&initializer) == NULL && fcntl(0, F_GETFD) != -1,
+    "rendezvous too long");
+
+  rmdir(runtime);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,75 @@
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process that will not exit after a `SIGTERM` is written
+ * down before it is killed, and the starter can read what was written. */
+
+static int count = 0;
+static char snapped[16384];
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * stubborn[] = { "stubborn", NULL };
+  char const * beat[] = { NULL };
+  count++;
+  if (restart) {
+    attendant.snapshot(snapped, sizeof(snapped));
+  }
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/companion"),
+    count == 1 ? stubborn : beat, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  struct attendant__usage usage;
+  char buffer[16], expected[64];
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.companion = 1;
+  initializer.snapshot = sizeof(snapped);
+
+  printf("1..7\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && count == 1, "ready");
+  ok(attendant.snapshot(buffer, sizeof(buffer)) == 0 && buffer[0] == '\0',
+    "no snapshot");
+
+  ok(attendant.retry(250) == 1 && count == 2, "restarted");
+  usage = attendant.usage();
+  ok(WIFSIGNALED(usage.status) && WTERMSIG(usage.status) == SIGKILL, "killed");
+
+  sprintf(expected, "pid %d at ", usage.pid);
+  ok(strncmp(snapped, expected, strlen(expected)) == 0
+    && strstr(snapped, "\nthread ") != NULL
+    && strstr(snapped, "(companion) S\n") != NULL, "snapshot");
+
+  ok(attendant.snapshot(buffer, sizeof(buffer)) == sizeof(buffer) - 1
+    && strncmp(buffer, snapped, sizeof(buffer) - 1) == 0, "cut short");
+
+  attendant.shutdown();
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
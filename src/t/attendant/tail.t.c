@@ -0,0 +1,85 @@
+#include <limits.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* Standard out is left to the plugin stub, and the starter of a plugin server
+ * process that crashed can see the last of its standard error, how it exited
+ * and for how long it ran. */
+
+static int count = 0, ran = -1, status = 0;
+static char tail[64];
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * crash[] = { "crash", NULL };
+  char const * exit[] = { NULL };
+  if (restart) {
+    attendant.tail(tail, sizeof(tail));
+    status = attendant.usage().status;
+    ran = uptime;
+  }
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/crash"),
+    count == 1 ? crash : exit, 0);
+}
+
+static attendant__pipe_t stdin_pipe, stdout_pipe;
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  stdin_pipe = in;
+  stdout_pipe = out;
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  const char *last = "fatal: out of widgets\n";
+  char buffer[64];
+  int err, i;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.stdio = ATTENDANT_STDIO_STUB;
+  initializer.tail = sizeof(tail) - 1;
+
+  printf("1..6\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1, "ready");
+
+  /* Were we to drain it, it would be gone by now. */
+  usleep(300 * 1000);
+  HANDLE_EINTR(read(stdout_pipe, buffer, sizeof(buffer)), err);
+  ok(err == 6 && memcmp(buffer, "hello\n", 6) == 0, "standard out is ours");
+
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  for (i = 0; i < 10000 && count < 2; i++) {
+    usleep(1000);
+  }
+  ok(count == 2 && ran >= 0 && ran < 10, "restarted");
+  ok(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT, "status");
+  ok(strlen(tail) == sizeof(tail) - 1
+    && strcmp(tail + strlen(tail) - strlen(last), last) == 0, "tail");
+
+  attendant.ready();
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process reattaches to the warm state built by the plugin
+ * server process before it, unless that one died while changing it. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * argv[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/warm"), argv, 0);
+}
+
+static attendant__pipe_t stdin_pipe;
+static char said[64];
+
+/* Remember what the plugin server process said when it started. */
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+  int err;
+  stdin_pipe = in;
+  memset(said, 0, sizeof(said));
+  HANDLE_EINTR(read(out, said, sizeof(said) - 1), err);
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  int err, i;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.warm = 1024 * 1024;
+
+  printf("1..5\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && strcmp(said, "BUILT built 1\n") == 0, "built");
+  ok(attendant.retry(0) == 1 && count == 2
+    && strcmp(said, "REATTACHED built 1\n") == 0, "reattached");
+
+  /* Crash in the middle of a change, and wait for the restart. */
+  HANDLE_EINTR(write(stdin_pipe, "tear\n", 5), err);
+  for (i = 0; i < 30000 && count < 3; i++) {
+    usleep(1000);
+  }
+  ok(attendant.ready() == 1 && count == 3
+    && strcmp(said, "BUILT built 2\n") == 0, "rebuilt after tear");
+
+  attendant.shutdown();
+  HANDLE_EINTR(write(stdin_pipe, "\n", 1), err);
+  ok(attendant.done(30000), "done");
+  ok(attendant.errors().attendant == 0, "no errors");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+#include <limits.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../../attendant.h"
+#include "../ok.h"
+#include "../../../eintr.h"
+
+/* A plugin server process whose heartbeat stops is restarted without a call to
+ * `retry`, and one that beats is left alone. */
+
+static int count = 0;
+
+void starter(int restart, int uptime) {
+  char path[PATH_MAX];
+  char const * hang[] = { "hang", NULL };
+  char const * beat[] = { NULL };
+  count++;
+  attendant.start(strcat(getcwd(path, PATH_MAX), "/t/bin/companion"),
+    count == 1 ? hang : beat, 0);
+}
+
+void connector(attendant__pipe_t in, attendant__pipe_t out) {
+}
+
+int main() {
+  struct attendant__initializer initializer;
+  long long ready;
+  int i;
+
+  memset(&initializer, 0, sizeof(initializer));
+
+  initializer.starter = starter;
+  initializer.connector = connector;
+  strcat(getcwd(initializer.relay, sizeof(initializer.relay)), "/relay");
+  initializer.canary = 31;
+  initializer.companion = 1;
+  initializer.watchdog = 500;
+
+  printf("1..5\n");
+
+  attendant.initialize(&initializer);
+  starter(0, 0);
+
+  ok(attendant.ready() == 1 && count == 1, "ready");
+  ready = attendant.clock();
+
+  /* No one calls `retry`. */
+  for (i = 0; i < 10000 && count < 2; i++) {
+    usleep(1000);
+  }
+  ok(count == 2 && attendant.clock() - ready >= 500, "hang detected");
+  ok(attendant.ready() == 1, "restarted");
+
+  /* A plugin server process that beats is not hung. */
+  usleep(1500 * 1000);
+  ok(count == 2, "beating");
+
+  attendant.shutdown();
+  ok(attendant.done(30000), "done");
+  attendant.destroy();
+
+  return EXIT_SUCCESS;
+}
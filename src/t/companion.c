@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+
+#include "../../attendant_server.h"
+
+/* This is a testing server for the companion library. It takes its time to
+ * start, then says that it is ready, and beats until it is asked to shut down.
+ * It never reads standard input. Given `hang`, it never beats, and never
+ * shuts down. Given `stubborn`, it also ignores `SIGTERM`. Given `pressure`,
+ * it exits when it is told of pressure. */
+int main(int argc, char *argv[]) {
+  struct pollfd control;
+  int err;
+
+  if (argc > 1 && strcmp(argv[1], "stubborn") == 0) {
+    signal(SIGTERM, SIG_IGN);
+  }
+
+  usleep(300 * 1000);
+
+  if (attendant_server.ready() == -1) {
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1 && (strcmp(argv[1], "hang") == 0
+      || strcmp(argv[1], "stubborn") == 0)) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  control.fd = attendant_server.fd();
+  control.events = POLLIN;
+  while (! attendant_server.shutdown()) {
+    if (argc > 1 && strcmp(argv[1], "pressure") == 0
+        && attendant_server.pressure() != 0) {
+      return EXIT_SUCCESS;
+    }
+    attendant_server.beat();
+    do {
+      err = poll(&control, 1, 100);
+    } while (err == -1 && errno == EINTR);
+  }
+
+  return EXIT_SUCCESS;
+}
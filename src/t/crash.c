@@ -0,0 +1,29 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* This is a testing server that says hello on standard out and waits for a
+ * line on standard in. Given `crash`, it then writes more than we will keep to
+ * standard error and aborts. Otherwise, it exits. */
+int main(int argc, char *argv[]) {
+  char line[256];
+  int i;
+
+  printf("hello\n");
+  fflush(stdout);
+
+  if (fgets(line, sizeof(line), stdin) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  if (argc > 1 && strcmp(argv[1], "crash") == 0) {
+    for (i = 0; i < 100; i++) {
+      fprintf(stderr, "line %d\n", i);
+    }
+    fprintf(stderr, "fatal: out of widgets\n");
+    abort();
+  }
+
+  return EXIT_SUCCESS;
+}
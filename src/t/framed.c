@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "../../attendant.h"
+
+/* This is a testing server for the stable endpoint. It reads frames from
+ * standard input and echoes each one back on standard output. Its first
+ * argument is its instance number. A request of `first` is answered by any
+ * instance but the first, which exits instead. A request of `exit` is never
+ * answered. It exits at the end of standard input. */
+
+/* Read exactly the given number of bytes, or return false. */
+static int fill(void *buffer, size_t length) {
+  ssize_t err;
+  size_t offset = 0;
+  while (offset < length) {
+    do {
+      err = read(STDIN_FILENO, (char *) buffer + offset, length - offset);
+    } while (err == -1 && errno == EINTR);
+    if (err <= 0) {
+      return 0;
+    }
+    offset += err;
+  }
+  return 1;
+}
+
+int main(int argc, char *argv[]) {
+  struct attendant__frame header;
+  int instance = argc > 1 ? atoi(argv[1]) : 1;
+  char payload[256];
+
+  while (fill(&header, sizeof(header))) {
+    if (header.length >= sizeof(payload) || ! fill(payload, header.length)) {
+      break;
+    }
+    payload[header.length] = '\0';
+    if (strcmp(payload, "exit") == 0
+        || (strcmp(payload, "first") == 0 && instance == 1)) {
+      break;
+    }
+    header.flags = 0;
+    if (write(STDOUT_FILENO, &header, sizeof(header)) != sizeof(header)
+        || write(STDOUT_FILENO, payload, header.length) != header.length) {
+      break;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+/* This is a testing server for inheritance. If it has inherited a file named
+ * `memo` as systemd would pass it, it says what the file says. Otherwise it
+ * writes a memo and registers it for the next instance. It exits on any input
+ * on standard input, or when standard input hangs up. */
+
+/* Register a file descriptor with the plugin attendant. */
+static void bequeath(const char *name, int fd) {
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov;
+  struct msghdr message;
+  struct cmsghdr *cmsg;
+  const char *registry = getenv("ATTENDANT_REGISTRY");
+  int err;
+
+  if (registry == NULL) {
+    return;
+  }
+
+  memset(&message, 0, sizeof(message));
+  memset(control, 0, sizeof(control));
+  iov.iov_base = (void *) name;
+  iov.iov_len = strlen(name);
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  do {
+    err = sendmsg(atoi(registry), &message, 0);
+  } while (err == -1 && errno == EINTR);
+}
+
+int main() {
+  const char *count = getenv("LISTEN_FDS"), *pid = getenv("LISTEN_PID"),
+    *names = getenv("LISTEN_FDNAMES"), *memo = "instance 1";
+  char buffer[64], path[] = "/tmp/heir.XXXXXX";
+  int fd, err;
+
+  if (count != NULL && strcmp(count, "1") == 0
+      && pid != NULL && atoi(pid) == getpid()
+      && names != NULL && strcmp(names, "memo") == 0) {
+    memset(buffer, 0, sizeof(buffer));
+    lseek(3, 0, SEEK_SET);
+    do {
+      err = read(3, buffer, sizeof(buffer) - 1);
+    } while (err == -1 && errno == EINTR);
+    printf("INHERITED %s\n", buffer);
+  } else {
+    fd = mkstemp(path);
+    unlink(path);
+    do {
+      err = write(fd, memo, strlen(memo));
+    } while (err == -1 && errno == EINTR);
+    bequeath("memo", fd);
+    close(fd);
+    printf("CREATED\n");
+  }
+  fflush(stdout);
+
+  do {
+    err = read(STDIN_FILENO, buffer, sizeof(buffer));
+  } while (err == -1 && errno == EINTR);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+/* This is a testing server for recycling. It leaks a megabyte every fiftieth
+ * of a second, touching every page, so that it is resident. It exits on any
+ * input on standard input, or when standard input hangs up. */
+int main() {
+  struct pollfd input;
+  char *leak;
+  int err;
+
+  input.fd = STDIN_FILENO;
+  input.events = POLLIN;
+  for (;;) {
+    if ((leak = malloc(1024 * 1024)) != NULL) {
+      memset(leak, 1, 1024 * 1024);
+    }
+    do {
+      err = poll(&input, 1, 20);
+    } while (err == -1 && errno == EINTR);
+    if (err != 0) {
+      break;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
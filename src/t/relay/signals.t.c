@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <limits.h>
 #include <unistd.h>
+#include <signal.h>
 
 #include "../ok.h"
 #include "../reset.h"
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* This is a testing server for the sealed blob. It maps the blob at file
+ * descriptor 3 and says what it says, and whether it could be changed. It
+ * exits on any input on standard input, or when standard input hangs up. */
+int main() {
+  const char *names = getenv("LISTEN_FDNAMES");
+  const char *sealed = "SEALED";
+  struct stat stat;
+  char *blob, buffer[64];
+  int err;
+
+  if (names == NULL || strcmp(names, "blob") != 0 || fstat(3, &stat) == -1) {
+    printf("MISSING\n");
+    return EXIT_FAILURE;
+  }
+  blob = mmap(NULL, stat.st_size, PROT_READ, MAP_SHARED, 3, 0);
+  if (blob == MAP_FAILED) {
+    printf("MISSING\n");
+    return EXIT_FAILURE;
+  }
+
+  /* A write must fail, through the descriptor or through a mapping. */
+  if (write(3, "x", 1) != -1 || ftruncate(3, 0) != -1
+      || mmap(NULL, stat.st_size, PROT_WRITE, MAP_SHARED, 3, 0) != MAP_FAILED) {
+    sealed = "UNSEALED";
+  }
+
+  printf("BLOB %.*s %s\n", (int) stat.st_size, blob, sealed);
+  fflush(stdout);
+
+  do {
+    err = read(STDIN_FILENO, buffer, sizeof(buffer));
+  } while (err == -1 && errno == EINTR);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* This is a testing server for shared mode. It listens on the socket named by
+ * its first argument in `$XDG_RUNTIME_DIR`. It holds one reference for
+ * standard input and one for each connection. Any input, or a hang up, drops
+ * the reference. It exits when the last reference is gone. If another is
+ * already listening, it exits at once. */
+int main(int argc, char *argv[]) {
+  struct sockaddr_un address;
+  struct pollfd fds[64];
+  int listener, fd, count = 2, references = 1, i, err;
+  char buffer[64];
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s/%s",
+    getenv("XDG_RUNTIME_DIR"), argv[1]);
+
+  listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1) {
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) == 0) {
+      return EXIT_SUCCESS;
+    }
+    unlink(address.sun_path);
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1) {
+      return EXIT_FAILURE;
+    }
+  }
+  listen(listener, 16);
+
+  printf("RUNNING\n");
+  fflush(stdout);
+
+  fds[0].fd = STDIN_FILENO;
+  fds[1].fd = listener;
+  while (references) {
+    for (i = 0; i < count; i++) {
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    do {
+      err = poll(fds, count, -1);
+    } while (err == -1 && errno == EINTR);
+    if (fds[0].revents) {
+      fds[0].fd = -1;
+      references--;
+    }
+    if (fds[1].revents && (fd = accept(listener, NULL, NULL)) != -1) {
+      fds[count++].fd = fd;
+      references++;
+    }
+    for (i = 2; i < count; i++) {
+      if (fds[i].fd != -1 && fds[i].revents) {
+        read(fds[i].fd, buffer, sizeof(buffer));
+        close(fds[i].fd);
+        fds[i].fd = -1;
+        references--;
+      }
+    }
+  }
+
+  unlink(address.sun_path);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../../attendant.h"
+
+/* This is a testing server for warm state. It maps the region at file
+ * descriptor 3 and reattaches to the state built by a predecessor, or builds
+ * it anew. It exits on any input on standard input, or when standard input
+ * hangs up, but on `tear` it exits in the middle of a change. */
+int main() {
+  const char *names = getenv("LISTEN_FDNAMES");
+  struct attendant__warm *warm;
+  struct stat stat;
+  char *state, buffer[64];
+  int err;
+
+  if (names == NULL || strcmp(names, "warm") != 0 || fstat(3, &stat) == -1) {
+    printf("MISSING\n");
+    return EXIT_FAILURE;
+  }
+  warm = mmap(NULL, stat.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, 3, 0);
+  if (warm == MAP_FAILED || warm->magic != ATTENDANT_WARM_MAGIC
+      || warm->size != (unsigned long long) stat.st_size) {
+    printf("MISSING\n");
+    return EXIT_FAILURE;
+  }
+  state = (char *) warm + ATTENDANT_WARM_HEADER;
+
+  if (warm->version == 1 && warm->sequence % 2 == 0) {
+    printf("REATTACHED %s\n", state);
+  } else {
+    warm->sequence++;
+    sprintf(state, "built %d", warm->sequence > 1 ? 2 : 1);
+    warm->length = strlen(state) + 1;
+    warm->version = 1;
+    warm->sequence++;
+    printf("BUILT %s\n", state);
+  }
+  fflush(stdout);
+
+  memset(buffer, 0, sizeof(buffer));
+  do {
+    err = read(STDIN_FILENO, buffer, sizeof(buffer) - 1);
+  } while (err == -1 && errno == EINTR);
+
+  /* Begin a change and die before it is done. */
+  if (strcmp(buffer, "tear\n") == 0) {
+    warm->sequence++;
+    _exit(EXIT_FAILURE);
+  }
+
+  return EXIT_SUCCESS;
+}